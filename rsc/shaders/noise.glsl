@@ -0,0 +1,271 @@
+// Perlin noise shared by vertex.glsl and fragment.glsl, which include it
+// with #include "noise.glsl". Shader::readShaderFile() pastes it in.
+
+#define SQRT2 1.41421356273
+#define SQRT3 1.73205080757
+
+// The permutation table comes from one of three sources, picked by a
+// define the application adds when it compiles the shader. All three
+// give the same value for indices below 512.
+#if defined(PERM_TEXTURE)
+uniform usampler1D permTexture;	// 256 x R8UI
+
+int perm(int i)
+{
+	return int(texelFetch(permTexture, i & 255, 0).r);
+}
+#elif defined(PERM_HASH)
+uniform uint permKey;
+
+// Must match Noise::hash().
+int perm(int i)
+{
+	uint x = (uint(i) & 255u) ^ (permKey & 255u);
+	x = (x * 109u + ((permKey >> 8) & 255u)) & 255u;
+	x ^= x >> 4;
+	x = (x * 181u + ((permKey >> 16) & 255u)) & 255u;
+	x ^= x >> 3;
+	x = (x * 75u + (permKey >> 24)) & 255u;
+	x ^= x >> 4;
+	return int(x);
+}
+#else
+uniform int[512] permTable;
+
+int perm(int i)
+{
+	return permTable[i];
+}
+#endif
+/**
+ *	Input a t in the range [0,1] and outputs
+ *	a smoothed values also in the range [0,1].
+ *	Uses the function 6t^5 - 15t^4 + 10t^3 
+ */
+float ease(float t)
+{
+	return ((6*t - 15)*t + 10)*t*t*t;
+}
+
+vec2 getGradient2D(int cornerValue)
+{
+	// return one of four gradient vectors.
+	int v = cornerValue & 3;	
+	if (v == 0)
+		return vec2(SQRT2, 0);
+	else if (v == 1)
+		return vec2(0, SQRT2);
+	else if (v == 2)
+		return vec2(-SQRT2, 0);
+	else 
+		return vec2(0, -SQRT2);
+}
+
+vec3 getGradient3D(int cornerValue)
+{
+	// return one of eight gradient vectors.
+	int v = cornerValue & 7;	
+	if (v == 0)
+		return vec3(SQRT3, 0, 0);
+	else if (v == 1)
+		return vec3(0, SQRT3, 0);
+	else if (v == 2)
+		return vec3(-SQRT3, 0, 0);
+	else if (v == 3)
+		return vec3(0, -SQRT3, 0);
+	else if (v == 4)
+		return vec3(0, 0, SQRT3);
+	else if (v == 5)
+		return vec3(0, 0, -SQRT3);
+	else if (v == 6)
+		return vec3(0, -SQRT3 / SQRT2, SQRT3 / SQRT2);
+	else
+		return vec3(0, SQRT3 / SQRT2, -SQRT3 / SQRT2);
+}
+
+/**
+ * The following code was adapted from https://rtouti.github.io/graphics/perlin-noise-algorithm
+ * Computes the 2D perlin noise.
+ * Returns a value in the range [0,1].
+ */
+float noise(vec2 vec)
+{
+	// Get the lower left corner of the grid.
+	int xi = int(vec.x) & 255;
+	int yi = int(vec.y) & 255;
+
+	// Compute the vector pointing from the corner to the
+	// given point. Place the fractional part of point in [0,1]^2.
+	vec2 frac = vec - vec2(int(vec.x), int(vec.y));
+
+	//if (frac.x < 0)
+	//	frac.x += 1.0f;
+	//if (frac.y < 0)
+	//	frac.y += 1.0f;
+	vec2 fracSign = (-sign(frac) + vec2(1.0)) * 0.5;
+	frac += fracSign;
+
+	vec2 topRight = frac - vec2(1.0f, 1.0f); 
+	vec2 topLeft = frac - vec2(0.0f, 1.0f); 
+	vec2 botRight = frac - vec2(1.0f, 0.0f); 
+	vec2 botLeft = frac;
+
+	// Get a value from permuation matrix for the four
+	// corners of the grid cell. Take care to keep index in bounds.
+	int left = perm(xi);
+	int right = perm(xi + 1);
+	int valueTopRight = perm(right + yi + 1);
+	int valueTopLeft = perm(left + yi + 1);
+	int valueBotRight = perm(right + yi);
+	int valueBotLeft = perm(left + yi);
+
+	// Take the dot between the vector from corner to point and
+	// the gradient vector of the corner.
+	float dotTopRight = dot(topRight, getGradient2D(valueTopRight));
+	float dotTopLeft = dot(topLeft, getGradient2D(valueTopLeft));
+	float dotBotRight = dot(botRight, getGradient2D(valueBotRight));
+	float dotBotLeft = dot(botLeft, getGradient2D(valueBotLeft));
+
+	// Interpolate first vertically then horizontally.
+	// First ease the fractional values to create a smooth
+	// transistion between grids.
+	float u = ease(frac.x);
+	float v = ease(frac.y);
+	float vert1 = mix(dotBotLeft, dotTopLeft, v);
+	float vert2 = mix(dotBotRight, dotTopRight, v);
+	float value = mix(vert1, vert2, u);
+
+	// put in range [0,1]. -2 <= dotprod <= 2.
+	value = (value + 2.0) * 0.25;
+	return value;
+}
+
+/**
+ * The derivative of ease().
+ * Uses the function 30t^4 - 60t^3 + 30t^2
+ */
+float easeDerivative(float t)
+{
+	return 30*t*t*((t - 2)*t + 1);
+}
+
+/**
+ * The following code was adapted from
+ * 	(1) https://rtouti.github.io/graphics/perlin-noise-algorithm
+ * 	(2) https://mrl.cs.nyu.edu/~perlin/noise/
+ * 	(3) Ken Perlin. 1985. An image synthesizer. SIGGRAPH Comput. Graph. 19, 3 (Jul. 1985), 287–296.
+ * 		DOI:10.1145/325165.325247
+ *
+ * Computes the 3D perlin noise and its gradient in one pass.
+ * Returns a value in the range [0,1].
+ *
+ * For any 2 points that are spaced widely apart, the gradient of the noise
+ * function will be uncorrelated.
+ */
+float noise(vec3 vec, out vec3 gradient)
+{
+	// Get the lower back left corner of the cube.
+	int xi = int(floor(vec.x)) & 255;
+	int yi = int(floor(vec.y)) & 255;
+	int zi = int(floor(vec.z)) & 255;
+
+	// Compute the vector pointing from the corner to the
+	// given point. Place the fractional part of point in [0,1]^3.
+	vec3 frac = vec - floor(vec);
+
+	vec3 frontTopRight = frac - vec3(1.0f, 1.0f, 1.0f);
+	vec3 frontTopLeft = frac - vec3(0.0f, 1.0f, 1.0f);
+	vec3 frontBotRight = frac - vec3(1.0f, 0.0f, 1.0f);
+	vec3 frontBotLeft = frac - vec3(0.0f, 0.0f, 1.0f);
+
+	vec3 backTopRight = frac - vec3(1.0f, 1.0f, 0.0f);
+	vec3 backTopLeft = frac - vec3(0.0f, 1.0f, 0.0f);
+	vec3 backBotRight = frac - vec3(1.0f, 0.0f, 0.0f);
+	vec3 backBotLeft = frac - vec3(0.0f, 0.0f, 0.0f);
+
+	// Get a value from permuation matrix for the eight
+	// corners of the grid cell. Take care to keep index in bounds.
+	// The corners share their first two lookups, 14 reads in total.
+	int left = perm(xi);
+	int right = perm(xi + 1);
+	int topLeft = perm(left + yi + 1);
+	int topRight = perm(right + yi + 1);
+	int botLeft = perm(left + yi);
+	int botRight = perm(right + yi);
+
+	int valueFrontTopRight = perm(topRight + zi + 1);
+	int valueFrontTopLeft = perm(topLeft + zi + 1);
+	int valueFrontBotRight = perm(botRight + zi + 1);
+	int valueFrontBotLeft = perm(botLeft + zi + 1);
+
+	int valueBackTopRight = perm(topRight + zi);
+	int valueBackTopLeft = perm(topLeft + zi);
+	int valueBackBotRight = perm(botRight + zi);
+	int valueBackBotLeft = perm(botLeft + zi);
+
+	vec3 gradFrontTopRight = getGradient3D(valueFrontTopRight);
+	vec3 gradFrontTopLeft = getGradient3D(valueFrontTopLeft);
+	vec3 gradFrontBotRight = getGradient3D(valueFrontBotRight);
+	vec3 gradFrontBotLeft = getGradient3D(valueFrontBotLeft);
+
+	vec3 gradBackTopRight = getGradient3D(valueBackTopRight);
+	vec3 gradBackTopLeft = getGradient3D(valueBackTopLeft);
+	vec3 gradBackBotRight = getGradient3D(valueBackBotRight);
+	vec3 gradBackBotLeft = getGradient3D(valueBackBotLeft);
+
+	// Take the dot between the vector from corner to point and
+	// the gradient vector of the corner.
+	float dotFrontTopRight = dot(frontTopRight, gradFrontTopRight);
+	float dotFrontTopLeft = dot(frontTopLeft, gradFrontTopLeft);
+	float dotFrontBotRight = dot(frontBotRight, gradFrontBotRight);
+	float dotFrontBotLeft = dot(frontBotLeft, gradFrontBotLeft);
+
+	float dotBackTopRight = dot(backTopRight, gradBackTopRight);
+	float dotBackTopLeft = dot(backTopLeft, gradBackTopLeft);
+	float dotBackBotRight = dot(backBotRight, gradBackBotRight);
+	float dotBackBotLeft = dot(backBotLeft, gradBackBotLeft);
+
+	// Interpolate first vertically then horizontally.
+	// First ease the fractional values to create a smooth
+	// transistion between grids.
+	float u = ease(frac.x);
+	float v = ease(frac.y);
+	float w = ease(frac.z);
+	float frontVert1 = mix(dotFrontBotLeft, dotFrontTopLeft, v);
+	float frontVert2 = mix(dotFrontBotRight, dotFrontTopRight, v);
+	float frontHorz = mix(frontVert1, frontVert2, u);
+	float backVert1 = mix(dotBackBotLeft, dotBackTopLeft, v);
+	float backVert2 = mix(dotBackBotRight, dotBackTopRight, v);
+	float backHorz = mix(backVert1, backVert2, u);
+	float value = mix(backHorz, frontHorz, w);
+
+	// The value is trilinear in (u, v, w). Its gradient is the corner
+	// gradients blended with the same weights plus the rate of change
+	// of the weights themselves.
+	vec3 gradFront = mix(mix(gradFrontBotLeft, gradFrontTopLeft, v), mix(gradFrontBotRight, gradFrontTopRight, v), u);
+	vec3 gradBack = mix(mix(gradBackBotLeft, gradBackTopLeft, v), mix(gradBackBotRight, gradBackTopRight, v), u);
+	vec3 blended = mix(gradBack, gradFront, w);
+
+	float dU = mix(mix(dotBackBotRight - dotBackBotLeft, dotBackTopRight - dotBackTopLeft, v),
+			mix(dotFrontBotRight - dotFrontBotLeft, dotFrontTopRight - dotFrontTopLeft, v), w);
+	float dV = mix(mix(dotBackTopLeft - dotBackBotLeft, dotBackTopRight - dotBackBotRight, u),
+			mix(dotFrontTopLeft - dotFrontBotLeft, dotFrontTopRight - dotFrontBotRight, u), w);
+	float dW = frontHorz - backHorz;
+	vec3 easeRate = vec3(easeDerivative(frac.x), easeDerivative(frac.y), easeDerivative(frac.z));
+
+	// put in range [0,1]. -3 <= dotprod <= 3.
+	value = (value + 3.0) * 0.16667;
+	gradient = (blended + easeRate * vec3(dU, dV, dW)) * 0.16667;
+	return value;
+}
+
+/**
+ * Computes the 3D perlin noise.
+ * Returns a value in the range [0,1].
+ */
+float noise(vec3 vec)
+{
+	// The unused gradient is optimised away by the compiler.
+	vec3 gradient;
+	return noise(vec, gradient);
+}
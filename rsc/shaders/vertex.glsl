@@ -3,21 +3,142 @@
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec3 inNormal;
 layout (location = 2) in vec2 inTexCoord;
+// Constants set by Mesh::draw() for the whole mesh. COMPACT meshes store
+// positions normalized to their bounding box and octahedral normals.
+layout (location = 9) in vec4 positionScale;	// xyz scale, w is 1 for octahedral normals
+layout (location = 10) in vec3 positionOffset;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 perspective;
-uniform vec3 lightPos;
+// Must match FrameBlock and ModelBlock in src/UniformBlocks.h and the
+// declarations in fragment.glsl.
+layout (std140) uniform FrameBlock
+{
+	mat4 view;
+	mat4 perspective;
+	vec3 toCamera;
+	float time;
+	vec3 lightPos;
+};
+
+#if defined(INSTANCED)
+// Must match InstanceData in src/UniformBlocks.h. The same settings as
+// ModelBlock, one set per instance, handed on to fragment.glsl.
+layout (location = 3) in mat4 instanceModel;
+layout (location = 7) in vec4 instanceFloats;	// persistence, ringFreq, phaseSpeed, unused
+layout (location = 8) in ivec4 instanceInts;	// effect, octaveCount, octaveStart, waveCenters
+
+flat out int effect;
+flat out float persistence;
+flat out int octaveCount;
+flat out int octaveStart;
+flat out float ringFreq;
+flat out int waveCenters;
+flat out float phaseSpeed;
+#else
+layout (std140) uniform ModelBlock
+{
+	mat4 model;
+	int effect;	// Chooses a perlin texture to apply.
+	float persistence;
+	int octaveCount;
+	int octaveStart;
+	float ringFreq;	// rings frequency of wood.
+	int waveCenters;
+	float phaseSpeed;
+	bool bakedTurbulence;	// Sample turbulenceVolume instead of summing octaves.
+	float turbulencePeriod;	// The volume repeats every turbulencePeriod units.
+};
+#endif
 
 out vec3 modelPos;
 out vec3 normal;
 out vec3 toLight;
 
+#if defined(PROCEDURAL_TERRAIN)
+#include "noise.glsl"
+
+// Set by ProceduralTerrain for every node it draws.
+uniform vec4 terrainNode;	// x and z of the node's corner, its size, grid quads per side
+uniform vec4 terrainMorph;	// xy are the distances where morphing starts and ends
+uniform vec4 terrainShape;	// height, frequency, persistence, texture scale
+uniform int terrainOctaves;
+
+/**
+ * fBm of noise(vec3) over the xz plane. slope is the height's rate of
+ * change along x and z, summed from the analytic gradient of each octave.
+ */
+float terrainHeight(vec2 ground, out vec2 slope)
+{
+	float height = 0;
+	float amplitude = terrainShape.x;
+	float frequency = terrainShape.y;
+	slope = vec2(0);
+	for (int i = 0; i < terrainOctaves; i++)
+	{
+		vec3 gradient;
+		float value = noise(vec3(ground.x * frequency, 0.5, ground.y * frequency), gradient);
+		height += (value - 0.5) * amplitude;
+		slope += gradient.xz * frequency * amplitude;
+		amplitude *= terrainShape.z;
+		frequency *= 2;
+	}
+	return height;
+}
+#elif defined(STREAMED_TERRAIN)
+// Set by TerrainStreamer, world to texture coordinates for fragment.glsl.
+uniform float terrainTextureScale;
+#endif
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0 ? 1.0 : -1.0, n.y >= 0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
 void main()
 {
-	vec4 worldPos = model * vec4(inPosition, 1.0);
+#if defined(INSTANCED)
+	mat4 model = instanceModel;
+	effect = instanceInts.x;
+	persistence = instanceFloats.x;
+	octaveCount = instanceInts.y;
+	octaveStart = instanceInts.z;
+	ringFreq = instanceFloats.y;
+	waveCenters = instanceInts.w;
+	phaseSpeed = instanceFloats.z;
+#endif
+#if defined(PROCEDURAL_TERRAIN)
+	// Towards the end of the node's range every odd grid vertex slides
+	// onto its even neighbour, so the node matches the coarser nodes
+	// around it by the time it is replaced (CDLOD morphing). Distances
+	// are measured to the y = 0 plane, like ProceduralTerrain does.
+	vec2 grid = inPosition.xz;
+	vec2 ground = terrainNode.xy + grid * terrainNode.z;
+	float cameraDistance = length(vec3(ground.x, 0, ground.y) - toCamera);
+	float morph = clamp((cameraDistance - terrainMorph.x) / (terrainMorph.y - terrainMorph.x), 0.0, 1.0);
+	vec2 index = floor(grid * terrainNode.w + 0.5);
+	grid -= mod(index, 2.0) / terrainNode.w * morph;
+	ground = terrainNode.xy + grid * terrainNode.z;
+
+	vec2 slope;
+	vec3 position = vec3(ground.x, terrainHeight(ground, slope), ground.y);
+	// The grid is already in world space.
+	vec4 worldPos = vec4(position, 1.0);
+	modelPos = position * terrainShape.w;
+	normal = normalize(vec3(-slope.x, 1, -slope.y));
+#elif defined(STREAMED_TERRAIN)
+	// TerrainStreamer's chunks are already in world space.
+	vec4 worldPos = vec4(inPosition, 1.0);
+	modelPos = inPosition * terrainTextureScale;
+	normal = inNormal;
+#else
+	vec3 position = positionOffset + positionScale.xyz * inPosition;
+	vec3 objectNormal = positionScale.w > 0.5 ? octDecode(inNormal.xy) : inNormal;
+	vec4 worldPos = model * vec4(position, 1.0);
+	modelPos = position;
+	normal = (model * vec4(objectNormal, 0)).xyz;
+#endif
     gl_Position = perspective * view * worldPos;
-	modelPos = inPosition;
-	normal = (model * vec4(inNormal, 0)).xyz;
 	toLight = lightPos - worldPos.xyz;
 }
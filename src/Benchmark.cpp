@@ -0,0 +1,601 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <glm/gtc/matrix_transform.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <noise/Noise.h>
+
+#include "Benchmark.h"
+#include "ThreadPool.h"
+#include "TurbulenceVolume.h"
+#include "PermSource.h"
+#include "Shader.h"
+#include "UniformBlocks.h"
+#include "UniformRing.h"
+#include "VertexArray.h"
+#include "MeshGroup.h"
+#include "ObjParser.h"
+#include "Frustum.h"
+#include "Scene.h"
+#include "TransformBatch.h"
+
+namespace
+{
+	/**
+	 * Returns the best of several runs of func in seconds.
+	 */
+	double timeIt(const std::function<void()>& func, int runs = 5)
+	{
+		double best = 1e30;
+		for (int i = 0; i < runs; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			func();
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			best = std::min(best, elapsed.count());
+		}
+		return best;
+	}
+
+	float maxDifference(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		float diff = 0;
+		for (std::size_t i = 0; i < a.size(); i++)
+			diff = std::max(diff, std::abs(a[i] - b[i]));
+		return diff;
+	}
+
+	/**
+	 * Compares the scalar and SIMD batch paths of the noise library
+	 * on random points, reporting throughput and the largest difference
+	 * from the scalar reference.
+	 */
+	int noiseBenchmark(int seed)
+	{
+		const std::size_t count = 1 << 20;
+		const int octaves = 4;
+
+		Noise noise(seed);
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+		std::vector<float> x(count), y(count), z(count);
+		for (std::size_t i = 0; i < count; i++)
+		{
+			x[i] = dist(rng);
+			y[i] = dist(rng);
+			z[i] = dist(rng);
+		}
+
+		std::vector<float> reference2(count), reference3(count), referenceTurb(count), referenceDx(count);
+		for (std::size_t i = 0; i < count; i++)
+		{
+			glm::vec3 gradient;
+			reference2[i] = noise.noise(glm::vec2(x[i], y[i]));
+			reference3[i] = noise.noise(glm::vec3(x[i], y[i], z[i]), gradient);
+			referenceDx[i] = gradient.x;
+			referenceTurb[i] = noise.turbulence(glm::vec3(x[i], y[i], z[i]), 0.5f, octaves, 0, 25);
+		}
+
+		// The analytic gradient should agree with the central difference
+		// that the shader used to compute with six noise calls.
+		const float h = 1e-3f;
+		float gradientError = 0;
+		for (std::size_t i = 0; i < count; i += 97)
+		{
+			float dx = (noise.noise(glm::vec3(x[i] + h, y[i], z[i])) -
+					noise.noise(glm::vec3(x[i] - h, y[i], z[i]))) / (2*h);
+			gradientError = std::max(gradientError, std::abs(dx - referenceDx[i]));
+		}
+		std::cout << "Analytic gradient vs central difference, max error " << gradientError << "\n";
+
+		Noise::Isa original = Noise::getIsa();
+		std::vector<float> out(count), dx(count), dy(count), dz(count);
+		std::cout << "Noise batch, " << count << " points, single thread\n";
+		for (int i = 0; i < Noise::COUNT; i++)
+		{
+			Noise::Isa isa = static_cast<Noise::Isa>(i);
+			if (!Noise::setIsa(isa))
+			{
+				std::cout << "  " << Noise::getIsaName(isa) << ": not supported\n";
+				continue;
+			}
+
+			double t2 = timeIt([&] { noise.noise(x.data(), y.data(), out.data(), count); });
+			float diff2 = maxDifference(out, reference2);
+			double t3 = timeIt([&] { noise.noise(x.data(), y.data(), z.data(), out.data(), count); });
+			float diff3 = maxDifference(out, reference3);
+			double tg = timeIt([&] {
+					noise.noise(x.data(), y.data(), z.data(), out.data(), dx.data(), dy.data(), dz.data(), count); });
+			float diffGrad = std::max(maxDifference(out, reference3), maxDifference(dx, referenceDx));
+			double tt = timeIt([&] {
+					noise.turbulence(x.data(), y.data(), z.data(), out.data(), count, 0.5f, octaves, 0, 25); });
+			float diffTurb = maxDifference(out, referenceTurb);
+
+			std::cout << "  " << Noise::getIsaName(isa) << ":"
+				<< " noise2 " << count / t2 * 1e-6 << " Mpts/s (max diff " << diff2 << "),"
+				<< " noise3 " << count / t3 * 1e-6 << " Mpts/s (max diff " << diff3 << "),"
+				<< " noise3+gradient " << count / tg * 1e-6 << " Mpts/s (max diff " << diffGrad << "),"
+				<< " turbulence x" << octaves << " " << count / tt * 1e-6 << " Mpts/s (max diff " << diffTurb << ")\n";
+		}
+		Noise::setIsa(original);
+
+		// TurbulenceVolume::bake() as a model's job runs it on one worker,
+		// and a check that the result tiles.
+		const int size = TurbulenceVolume::SIZE;
+		const int period = 8;
+		double tv = timeIt([&] { TurbulenceVolume::bake(noise, period, 0.5f, octaves, 0, 25); }, 3);
+
+		float tileError = 0;
+		for (std::size_t i = 0; i < count; i += 97)
+		{
+			glm::vec3 p(x[i], y[i], z[i]);
+			float a, b;
+			noise.turbulence(&p.x, &p.y, &p.z, &a, 1, 0.5f, octaves, 0, 25, period);
+			p += glm::vec3(period, -period, 2*period);
+			noise.turbulence(&p.x, &p.y, &p.z, &b, 1, 0.5f, octaves, 0, 25, period);
+			tileError = std::max(tileError, std::abs(a - b));
+		}
+		std::cout << "Turbulence volume " << size << "^3 x" << octaves << " octaves, "
+			<< "1 thread: " << tv * 1e3 << " ms"
+			<< " (max difference across a period " << tileError << ")\n";
+		return 0;
+	}
+
+	/**
+	 * Renders octaves of black and white turbulence over a full screen
+	 * quad into an offscreen framebuffer once per PermSource, timing the
+	 * GPU with GL_TIME_ELAPSED queries. Uses a hidden window, so nothing
+	 * appears on screen. The texture source should match the uniform
+	 * array exactly. The hash source uses a different permutation, so it
+	 * is only timed.
+	 */
+	int permBenchmark(int seed)
+	{
+		const int size = 1024;
+		const int passes = 20;
+		const int octaves = 8;
+
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		GLFWwindow* window = glfwCreateWindow(64, 64, "perm benchmark", nullptr, nullptr);
+		if (!window)
+		{
+			std::cerr << "Failed to create GLFW window" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cerr << "Failed to initialize GLAD" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
+		std::cout << "Perm sources, " << size << "x" << size << " pixels, " << octaves << " octaves, "
+			<< glGetString(GL_RENDERER) << "\n";
+
+		{
+			unsigned int framebuffer, colour;
+			glGenFramebuffers(1, &framebuffer);
+			glGenTextures(1, &colour);
+			glBindTexture(GL_TEXTURE_2D, colour);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colour, 0);
+			glViewport(0, 0, size, size);
+
+			// Clip space covers the screen, so identity matrices put the
+			// quad's model space coordinates straight into the noise.
+			std::vector<Vertex> vertices = {
+				{ glm::vec3(-1, -1, 0), glm::vec3(0, 0, 1), glm::vec2(0, 0) },
+				{ glm::vec3(1, -1, 0), glm::vec3(0, 0, 1), glm::vec2(1, 0) },
+				{ glm::vec3(1, 1, 0), glm::vec3(0, 0, 1), glm::vec2(1, 1) },
+				{ glm::vec3(-1, 1, 0), glm::vec3(0, 0, 1), glm::vec2(0, 1) } };
+			VertexArray quad(vertices, { 0, 1, 2, 0, 2, 3 });
+
+			FrameBlock frame = {};
+			frame.view = glm::mat4(1);
+			frame.perspective = glm::mat4(1);
+			frame.lightPos = glm::vec3(0, 0, 10);
+			ModelBlock model = {};
+			model.model = glm::mat4(1);
+			model.effect = 3;	// FragmentSettings::BLACK_WHITE
+			model.persistence = 0.5f;
+			model.octaveCount = octaves;
+			model.turbulencePeriod = 1;
+			UniformRing frameUniforms(sizeof(FrameBlock)), modelUniforms(sizeof(ModelBlock));
+			frameUniforms.write(frameUniforms.allocate(), &frame, 1);
+			modelUniforms.write(modelUniforms.allocate(), &model, 1);
+			frameUniforms.bind(0, FrameBlock::BINDING);
+			modelUniforms.bind(0, ModelBlock::BINDING);
+
+			unsigned int query;
+			glGenQueries(1, &query);
+			std::vector<unsigned char> reference, pixels(size * size * 4);
+			for (int i = 0; i < PermSource::COUNT; i++)
+			{
+				PermSource::Type type = static_cast<PermSource::Type>(i);
+				Noise noise(seed, PermSource::getPermutation(type));
+				PermSource permSource(type, noise);
+				Shader shader("shaders/vertex.glsl", "shaders/fragment.glsl",
+						std::vector<std::string>{ permSource.getDefine() });
+				if (!shader.link())
+					continue;
+				shader.bindUniformBlock("FrameBlock", FrameBlock::BINDING);
+				shader.bindUniformBlock("ModelBlock", ModelBlock::BINDING);
+				shader.use();
+				permSource.setUniforms(shader);
+				permSource.bind();
+				quad.bind();
+
+				// Warm up so compilation and uploads are not timed.
+				glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+				glFinish();
+
+				glBeginQuery(GL_TIME_ELAPSED, query);
+				for (int pass = 0; pass < passes; pass++)
+					glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+				glEndQuery(GL_TIME_ELAPSED);
+				GLuint64 elapsed = 0;
+				glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+				double seconds = elapsed * 1e-9 / passes;
+
+				glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+				std::cout << "  " << PermSource::getName(type) << ": " << seconds * 1e3 << " ms per frame, "
+					<< double(size) * size / seconds * 1e-6 << " Mpix/s";
+				if (type == PermSource::UNIFORM)
+				{
+					reference = pixels;
+				}
+				else if (type == PermSource::TEXTURE && !reference.empty())
+				{
+					int diff = 0;
+					for (std::size_t p = 0; p < pixels.size(); p++)
+						diff = std::max(diff, std::abs(int(pixels[p]) - int(reference[p])));
+					std::cout << " (max diff from uniform " << diff << ")";
+				}
+				std::cout << "\n";
+			}
+
+			glDeleteQueries(1, &query);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glDeleteTextures(1, &colour);
+			glDeleteFramebuffers(1, &framebuffer);
+		}
+
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return 0;
+	}
+
+	/**
+	 * Imports every OBJ file in models/ with Assimp and with ObjParser,
+	 * on one thread and across a pool, and checks that both give the
+	 * same triangles and bounds. ObjParser merges identical corners,
+	 * so it makes fewer vertices than Assimp.
+	 */
+	int objBenchmark()
+	{
+		std::vector<std::string> paths;
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator("models", error))
+		{
+			if (entry.path().extension() == ".obj")
+				paths.push_back(entry.path().string());
+		}
+		std::sort(paths.begin(), paths.end());
+		if (paths.empty())
+		{
+			std::cerr << "No OBJ files in models/. Run from the bin directory." << std::endl;
+			return -1;
+		}
+
+		ThreadPool pool;
+		std::cout << "OBJ import, best of 5, " << pool.getThreadCount() + 1 << " threads for the parallel parser\n";
+		for (const std::string& path : paths)
+		{
+			std::size_t assimpTriangles = 0;
+			std::size_t assimpVertices = 0;
+			glm::vec3 assimpMin(1e30f), assimpMax(-1e30f);
+			double ta = timeIt([&] {
+				Assimp::Importer importer;
+				const aiScene* scene = importer.ReadFile(path, MeshGroup::DEFAULT_IMPORT_FLAGS);
+				assimpTriangles = 0;
+				assimpVertices = 0;
+				for (unsigned int i = 0; scene && i < scene->mNumMeshes; i++)
+				{
+					MeshData data = Mesh::extractDataFromMesh(scene->mMeshes[i]);
+					assimpTriangles += data.indices.size() / 3;
+					assimpVertices += data.vertices.size();
+					const BoundingBox& box = data.boundingBox;
+					assimpMin = glm::min(assimpMin, glm::vec3(box.x, box.y, box.z));
+					assimpMax = glm::max(assimpMax, glm::vec3(box.x + box.width, box.y + box.height, box.z + box.depth));
+				}
+			});
+
+			MeshData mesh;
+			bool parsed = true;
+			double ts = timeIt([&] { parsed = ObjParser::parse(path, mesh); });
+			double tp = timeIt([&] { parsed = ObjParser::parse(path, mesh, &pool) && parsed; });
+			if (!parsed)
+			{
+				std::cout << "  " << path << ": Assimp " << ta * 1e3 << " ms, not supported by ObjParser\n";
+				continue;
+			}
+
+			const BoundingBox& box = mesh.boundingBox;
+			glm::vec3 boundsError = glm::max(glm::abs(glm::vec3(box.x, box.y, box.z) - assimpMin),
+					glm::abs(glm::vec3(box.x + box.width, box.y + box.height, box.z + box.depth) - assimpMax));
+			std::cout << "  " << path << ": Assimp " << ta * 1e3 << " ms, ObjParser " << ts * 1e3
+				<< " ms, parallel " << tp * 1e3 << " ms (" << ta / tp << "x). "
+				<< mesh.indices.size() / 3 << "/" << assimpTriangles << " triangles, "
+				<< mesh.vertices.size() << "/" << assimpVertices << " vertices, bounds error "
+				<< glm::max(boundsError.x, glm::max(boundsError.y, boundsError.z)) << "\n";
+		}
+		return 0;
+	}
+
+	/**
+	 * Culls random boxes scattered around the camera with the scalar and
+	 * SSE2 paths of Frustum::cull(), checking that both agree.
+	 */
+	int cullBenchmark(int seed)
+	{
+		const std::size_t count = 1 << 16;
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> size(0.1f, 5.0f);
+		BoxList boxes;
+		for (std::size_t i = 0; i < count; i++)
+		{
+			boxes.push_back({ position(rng), position(rng), position(rng), size(rng), size(rng), size(rng) });
+		}
+
+		glm::mat4 view = glm::lookAt(glm::vec3(0, 5, 12), glm::vec3(0), glm::vec3(0, 1, 0));
+		Frustum frustum(glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f) * view);
+		std::vector<unsigned char> scalar, simd;
+		std::size_t scalarVisible = 0, simdVisible = 0;
+		double ts = timeIt([&] { scalarVisible = frustum.cullScalar(boxes, scalar); });
+		double tv = timeIt([&] { simdVisible = frustum.cull(boxes, simd); });
+
+		std::cout << "Frustum culling " << count << " boxes, best of 5: scalar " << ts * 1e6 << " us, SIMD "
+			<< tv * 1e6 << " us (" << ts / tv << "x). " << simdVisible << " visible\n";
+		if (scalar != simd || scalarVisible != simdVisible)
+		{
+			std::cerr << "Scalar and SIMD culling disagree" << std::endl;
+			return -1;
+		}
+		return 0;
+	}
+
+	/**
+	 * Runs the per frame scene work on 100k objects scattered around the
+	 * camera: recompute the transforms that changed (1% per frame), cull
+	 * and gather the visible objects into a draw list. The Scene's
+	 * parallel arrays are compared with the same work on one heap
+	 * allocation per object, walked through shared_ptrs in shuffled
+	 * order, like the Renderer's models used to be.
+	 */
+	int sceneBenchmark(int seed)
+	{
+		struct Object
+		{
+			Transform transform;
+			BoundingBox localBox;
+			BoundingBox worldBox;
+			FragmentSettings settings;
+		};
+
+		const std::size_t count = 100000;
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> size(0.5f, 4.0f);
+		std::uniform_real_distribution<float> angle(0.0f, 6.28f);
+
+		Scene scene;
+		std::vector<Scene::Handle> handles;
+		std::vector<std::shared_ptr<Object>> objects;
+		std::vector<std::unique_ptr<char[]>> scatter;
+		for (std::size_t i = 0; i < count; i++)
+		{
+			BoundingBox box = { 0, 0, 0, size(rng), size(rng), size(rng) };
+			glm::vec3 place(position(rng), position(rng) * 0.1f, position(rng));
+			glm::vec3 turn(0, angle(rng), 0);
+
+			Scene::Handle handle = scene.add(nullptr, box);
+			scene.getTransform(handle).setPosition(place);
+			scene.getTransform(handle).rotate(turn);
+			handles.push_back(handle);
+
+			auto object = std::make_shared<Object>();
+			object->localBox = box;
+			object->transform.setPosition(place);
+			object->transform.rotate(turn);
+			objects.push_back(object);
+			scatter.push_back(std::make_unique<char[]>(64 + rng() % 512));
+		}
+		std::shuffle(objects.begin(), objects.end(), rng);
+		scene.update();
+		for (auto& object : objects)
+		{
+			object->transform.update();
+			object->worldBox = Frustum::transform(object->localBox, object->transform.getMatrix());
+		}
+
+		glm::mat4 view = glm::lookAt(glm::vec3(0, 5, 12), glm::vec3(0), glm::vec3(0, 1, 0));
+		Frustum frustum(glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f) * view);
+		std::vector<unsigned char> visible;
+		std::vector<std::size_t> drawList;
+		std::size_t frame = 0;
+		std::size_t sceneVisible = 0;
+		unsigned int sceneUpdated = 0;
+		double ts = timeIt([&] {
+			frame++;
+			for (std::size_t i = frame % 100; i < handles.size(); i += 100)
+				scene.getTransform(handles[i]).translate(glm::vec3(0.01f, 0, 0));
+			sceneUpdated = scene.update();
+			scene.cull(frustum, visible);
+			drawList.clear();
+			for (std::size_t i = 0; i < visible.size(); i++)
+			{
+				if (visible[i])
+					drawList.push_back(i);
+			}
+			sceneVisible = drawList.size();
+		}, 20);
+
+		BoxList boxes;
+		std::vector<Object*> objectDraws;
+		std::size_t objectVisible = 0;
+		frame = 0;
+		double to = timeIt([&] {
+			frame++;
+			for (std::size_t i = frame % 100; i < objects.size(); i += 100)
+				objects[i]->transform.translate(glm::vec3(0.01f, 0, 0));
+			boxes.clear();
+			for (auto& object : objects)
+			{
+				if (object->transform.update())
+					object->worldBox = Frustum::transform(object->localBox, object->transform.getMatrix());
+				boxes.push_back(object->worldBox);
+			}
+			frustum.cull(boxes, visible);
+			objectDraws.clear();
+			for (std::size_t i = 0; i < visible.size(); i++)
+			{
+				if (visible[i])
+					objectDraws.push_back(objects[i].get());
+			}
+			objectVisible = objectDraws.size();
+		}, 20);
+
+		std::cout << "Scene of " << count << " objects, update " << sceneUpdated << ", cull and build the draw list, best of 20: "
+			<< "scene arrays " << ts * 1e3 << " ms, shared_ptr objects " << to * 1e3 << " ms (" << to / ts << "x). "
+			<< sceneVisible << "/" << objectVisible << " visible\n";
+		return 0;
+	}
+
+	/**
+	 * Composes matrices and transforms boxes for random transforms, one
+	 * at a time with glm and with the scalar and AVX2 batch kernels,
+	 * checking that the kernels agree with glm. The count is not a
+	 * multiple of eight, so the tail is checked too.
+	 */
+	int transformBenchmark(int seed)
+	{
+		const std::size_t count = (1 << 16) + 3;
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+		std::uniform_real_distribution<float> size(0.1f, 5.0f);
+		TransformList transforms;
+		std::vector<BoundingBox> boxes;
+		for (std::size_t i = 0; i < count; i++)
+		{
+			Transform transform;
+			transform.setPosition(glm::vec3(position(rng), position(rng), position(rng)));
+			transform.setRotation(glm::normalize(glm::quat(unit(rng), unit(rng), unit(rng), unit(rng))));
+			transform.setScale(scale(rng));
+			transforms.push_back(transform);
+			boxes.push_back({ unit(rng), unit(rng), unit(rng), size(rng), size(rng), size(rng) });
+		}
+
+		std::vector<glm::mat4> reference(count), scalar(count), simd(count);
+		BoxList referenceBoxes, scalarBoxes, simdBoxes;
+		double tg = timeIt([&] {
+			for (std::size_t i = 0; i < count; i++)
+			{
+				glm::quat rotation(transforms.rotationW[i], transforms.rotationX[i], transforms.rotationY[i],
+						transforms.rotationZ[i]);
+				glm::vec3 translation(transforms.positionX[i], transforms.positionY[i], transforms.positionZ[i]);
+				reference[i] = glm::translate(glm::mat4(1), translation) * glm::mat4_cast(rotation) *
+					glm::scale(glm::mat4(1), glm::vec3(transforms.scale[i]));
+			}
+		});
+		double ts = timeIt([&] { TransformBatch::composeScalar(transforms, scalar.data()); });
+		double tv = timeIt([&] { TransformBatch::composeAvx2(transforms, simd.data()); });
+		double tgb = timeIt([&] {
+			referenceBoxes.clear();
+			for (std::size_t i = 0; i < count; i++)
+				referenceBoxes.push_back(Frustum::transform(boxes[i], reference[i]));
+		});
+		scalarBoxes.resize(count);
+		simdBoxes.resize(count);
+		double tsb = timeIt([&] { TransformBatch::transformBoxesScalar(reference.data(), boxes.data(), count, scalarBoxes); });
+		double tvb = timeIt([&] { TransformBatch::transformBoxesAvx2(reference.data(), boxes.data(), count, simdBoxes); });
+
+		// Relative to the size of the values, which reach a few hundred.
+		float matrixError = 0;
+		for (std::size_t i = 0; i < count; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				glm::vec4 scale = glm::max(glm::abs(reference[i][c]), glm::vec4(1));
+				glm::vec4 error = glm::max(glm::abs(scalar[i][c] - reference[i][c]), glm::abs(simd[i][c] - reference[i][c]));
+				error /= scale;
+				matrixError = std::max(matrixError, std::max(std::max(error.x, error.y), std::max(error.z, error.w)));
+			}
+		}
+		float boxError = 0;
+		const BoxList* lists[] = { &scalarBoxes, &simdBoxes };
+		for (const BoxList* list : lists)
+		{
+			boxError = std::max(boxError, std::max(maxDifference(list->minX, referenceBoxes.minX),
+						maxDifference(list->maxX, referenceBoxes.maxX)));
+			boxError = std::max(boxError, std::max(maxDifference(list->minY, referenceBoxes.minY),
+						maxDifference(list->maxY, referenceBoxes.maxY)));
+			boxError = std::max(boxError, std::max(maxDifference(list->minZ, referenceBoxes.minZ),
+						maxDifference(list->maxZ, referenceBoxes.maxZ)));
+		}
+
+		std::cout << "Composing " << count << " matrices, best of 5: glm " << tg * 1e3 << " ms, scalar "
+			<< ts * 1e3 << " ms, AVX2 " << tv * 1e3 << " ms (" << tg / tv << "x glm). Largest relative error "
+			<< matrixError << "\n";
+		std::cout << "Transforming " << count << " boxes: glm " << tgb * 1e3 << " ms, scalar " << tsb * 1e3
+			<< " ms, AVX2 " << tvb * 1e3 << " ms (" << tgb / tvb << "x glm). Largest error " << boxError << "\n";
+		if (!TransformBatch::hasAvx2())
+			std::cout << "This CPU has no AVX2, the AVX2 kernels ran the scalar ones.\n";
+		if (matrixError > 1e-5f || boxError > 1e-3f)
+		{
+			std::cerr << "Batch kernels disagree with glm" << std::endl;
+			return -1;
+		}
+		return 0;
+	}
+}
+
+/**
+ * Runs the named benchmark. Returns the process exit code.
+ */
+int Benchmark::run(const std::string& name, int seed)
+{
+	if (name == "noise")
+		return noiseBenchmark(seed);
+	if (name == "perm")
+		return permBenchmark(seed);
+	if (name == "obj")
+		return objBenchmark();
+	if (name == "cull")
+		return cullBenchmark(seed);
+	if (name == "scene")
+		return sceneBenchmark(seed);
+	if (name == "transform")
+		return transformBenchmark(seed);
+
+	std::cerr << "Unknown benchmark " << name << ". Available: noise, perm, obj, cull, scene, transform\n";
+	return -1;
+}
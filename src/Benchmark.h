@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+/*
+ * Headless benchmarks run with ./myapp --bench <name>.
+ * None of them open a window unless they need an OpenGL context.
+ */
+namespace Benchmark
+{
+	int run(const std::string& name, int seed);
+}
@@ -12,7 +12,9 @@ Camera::Camera(glm::vec3 position, glm::vec3 up, float yaw, float pitch) :
 	yaw(yaw),
 	pitch(pitch),
 	movementSpeed(2.5f),
-	mouseSensitivity(0.1f)
+	mouseSensitivity(0.1f),
+	moved(0),
+	velocity(0)
 {
 	updateCameraVectors();	
 }
@@ -20,19 +22,21 @@ Camera::Camera(glm::vec3 position, glm::vec3 up, float yaw, float pitch) :
 
 void Camera::processKeyboard(Movement direction, float deltaTime)
 {
-	float velocity = movementSpeed * deltaTime;
+	float distance = movementSpeed * deltaTime;
+	glm::vec3 start = position;
 	if (direction == FORWARD)
-		position += front * velocity;
+		position += front * distance;
 	if (direction == BACKWARD)
-		position -= front * velocity;
+		position -= front * distance;
 	if (direction == LEFT)
-		position -= right * velocity;
+		position -= right * distance;
 	if (direction == RIGHT)
-		position += right * velocity;
+		position += right * distance;
 	if (direction == UP)
-		position += up * velocity;
+		position += up * distance;
 	if (direction == DOWN)
-		position -= up * velocity;
+		position -= up * distance;
+	moved += position - start;
 
 	updateCameraVectors();
 }
@@ -55,6 +59,33 @@ void Camera::processMouseMovement(float xoffset, float yoffset)
 	updateCameraVectors();
 }
 
+/**
+ * Turns the movement since the last call into a velocity, smoothed over
+ * a few frames so it does not flicker between key presses. Call once a
+ * frame after the keyboard was processed.
+ */
+void Camera::update(float deltaTime)
+{
+	if (deltaTime <= 0)
+		return;
+	float blend = glm::min(deltaTime * 8.0f, 1.0f);
+	velocity = glm::mix(velocity, moved / deltaTime, blend);
+	moved = glm::vec3(0);
+}
+
+const glm::vec3& Camera::getFront() const
+{
+	return front;
+}
+
+/**
+ * World units per second the keyboard moved the camera, smoothed.
+ */
+const glm::vec3& Camera::getVelocity() const
+{
+	return velocity;
+}
+
 const glm::mat4& Camera::getViewMatrix()
 {
 	return view;
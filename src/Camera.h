@@ -28,7 +28,10 @@ public:
     const glm::mat4& getViewMatrix();
 	const glm::vec3& getPosition();
 	const glm::vec3& getDirection();
+	const glm::vec3& getFront() const;
+	const glm::vec3& getVelocity() const;
     void processKeyboard(Movement direction, float deltaTime);
+	void update(float deltaTime);
     void processMouseMovement(float xoffset, float yoffset);
 
 private:
@@ -46,6 +49,10 @@ private:
     // camera options
     float movementSpeed;
     float mouseSensitivity;
+	// Movement from processKeyboard() since the last update(), and the
+	// smoothed velocity update() derives from it.
+	glm::vec3 moved;
+	glm::vec3 velocity;
 
     void updateCameraVectors();
 };
@@ -0,0 +1,38 @@
+#pragma once
+
+/**
+ * Which effect fragment.glsl draws an object with, and its parameters.
+ */
+struct FragmentSettings
+{
+	enum NoiseType
+	{
+		GRASS = 0,
+		WOOD,
+		WATER,
+		BLACK_WHITE,
+		NONE,
+		/*
+		 * COUNT is not a NoiseType. It stores how many enums there are.
+		 */
+		COUNT
+	};
+
+	NoiseType noiseEffect;
+
+	// Turbulence parameters.
+	float persistence;
+	int octaveCount;
+	int octaveStart;
+	// Sample a baked volume instead of evaluating every octave.
+	bool bakedTurbulence = false;
+
+	// Wood parameters.
+	float ringFrequency;
+
+	// Wave parameters
+	int waveCenters;
+	float minFrequency;
+	float maxFrequency;
+	float phaseSpeed;
+};
@@ -0,0 +1,191 @@
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Frustum.h"
+
+void BoxList::clear()
+{
+	minX.clear();
+	minY.clear();
+	minZ.clear();
+	maxX.clear();
+	maxY.clear();
+	maxZ.clear();
+}
+
+void BoxList::push_back(const BoundingBox& box)
+{
+	minX.push_back(box.x);
+	minY.push_back(box.y);
+	minZ.push_back(box.z);
+	maxX.push_back(box.x + box.width);
+	maxY.push_back(box.y + box.height);
+	maxZ.push_back(box.z + box.depth);
+}
+
+void BoxList::resize(std::size_t count)
+{
+	minX.resize(count);
+	minY.resize(count);
+	minZ.resize(count);
+	maxX.resize(count);
+	maxY.resize(count);
+	maxZ.resize(count);
+}
+
+void BoxList::set(std::size_t i, const BoundingBox& box)
+{
+	minX[i] = box.x;
+	minY[i] = box.y;
+	minZ[i] = box.z;
+	maxX[i] = box.x + box.width;
+	maxY[i] = box.y + box.height;
+	maxZ[i] = box.z + box.depth;
+}
+
+BoundingBox BoxList::get(std::size_t i) const
+{
+	return { minX[i], minY[i], minZ[i], maxX[i] - minX[i], maxY[i] - minY[i], maxZ[i] - minZ[i] };
+}
+
+/**
+ * Removes box i by moving the last box into its place.
+ */
+void BoxList::removeSwap(std::size_t i)
+{
+	std::vector<float>* arrays[] = { &minX, &minY, &minZ, &maxX, &maxY, &maxZ };
+	for (std::vector<float>* array : arrays)
+	{
+		(*array)[i] = array->back();
+		array->pop_back();
+	}
+}
+
+std::size_t BoxList::size() const
+{
+	return minX.size();
+}
+
+/**
+ * Extracts the planes from the rows of viewProjection, following
+ * Gribb and Hartmann, "Fast Extraction of Viewing Frustum Planes from
+ * the World-View-Projection Matrix".
+ */
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	glm::mat4 rows = glm::transpose(viewProjection);
+	planes[0] = rows[3] + rows[0];	// Left
+	planes[1] = rows[3] - rows[0];	// Right
+	planes[2] = rows[3] + rows[1];	// Bottom
+	planes[3] = rows[3] - rows[1];	// Top
+	planes[4] = rows[3] + rows[2];	// Near
+	planes[5] = rows[3] - rows[2];	// Far
+}
+
+bool Frustum::intersects(const BoundingBox& box) const
+{
+	for (const glm::vec4& plane : planes)
+	{
+		float x = plane.x > 0 ? box.x + box.width : box.x;
+		float y = plane.y > 0 ? box.y + box.height : box.y;
+		float z = plane.z > 0 ? box.z + box.depth : box.z;
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Sets visible[i] to 1 for every box that intersects the frustum and to
+ * 0 otherwise. Returns how many are visible. Four boxes are tested at a
+ * time with SSE2. Which corner to test only depends on the plane, so
+ * each plane just picks the min or max array per axis.
+ */
+std::size_t Frustum::cull(const BoxList& boxes, std::vector<unsigned char>& visible) const
+{
+#if defined(__SSE2__)
+	std::size_t count = boxes.size();
+	visible.resize(count);
+	const float* x[6];
+	const float* y[6];
+	const float* z[6];
+	__m128 nx[6], ny[6], nz[6], nw[6];
+	for (int p = 0; p < 6; p++)
+	{
+		x[p] = planes[p].x > 0 ? boxes.maxX.data() : boxes.minX.data();
+		y[p] = planes[p].y > 0 ? boxes.maxY.data() : boxes.minY.data();
+		z[p] = planes[p].z > 0 ? boxes.maxZ.data() : boxes.minZ.data();
+		nx[p] = _mm_set1_ps(planes[p].x);
+		ny[p] = _mm_set1_ps(planes[p].y);
+		nz[p] = _mm_set1_ps(planes[p].z);
+		nw[p] = _mm_set1_ps(planes[p].w);
+	}
+
+	std::size_t visibleCount = 0;
+	std::size_t i = 0;
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 outside = zero;
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(nx[p], _mm_loadu_ps(x[p] + i)), _mm_mul_ps(ny[p], _mm_loadu_ps(y[p] + i))),
+					_mm_add_ps(_mm_mul_ps(nz[p], _mm_loadu_ps(z[p] + i)), nw[p]));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+		}
+		int mask = _mm_movemask_ps(outside);
+		for (int k = 0; k < 4; k++)
+		{
+			visible[i + k] = !(mask & (1 << k));
+			visibleCount += visible[i + k];
+		}
+	}
+	for (; i < count; i++)
+	{
+		BoundingBox box = { boxes.minX[i], boxes.minY[i], boxes.minZ[i],
+			boxes.maxX[i] - boxes.minX[i], boxes.maxY[i] - boxes.minY[i], boxes.maxZ[i] - boxes.minZ[i] };
+		visible[i] = intersects(box);
+		visibleCount += visible[i];
+	}
+	return visibleCount;
+#else
+	return cullScalar(boxes, visible);
+#endif
+}
+
+/**
+ * The same as cull() one box at a time.
+ */
+std::size_t Frustum::cullScalar(const BoxList& boxes, std::vector<unsigned char>& visible) const
+{
+	std::size_t count = boxes.size();
+	visible.resize(count);
+	std::size_t visibleCount = 0;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		BoundingBox box = { boxes.minX[i], boxes.minY[i], boxes.minZ[i],
+			boxes.maxX[i] - boxes.minX[i], boxes.maxY[i] - boxes.minY[i], boxes.maxZ[i] - boxes.minZ[i] };
+		visible[i] = intersects(box);
+		visibleCount += visible[i];
+	}
+	return visibleCount;
+}
+
+/**
+ * The axis aligned box around box after matrix is applied, following
+ * Arvo, "Transforming Axis-Aligned Bounding Boxes": the center is
+ * transformed and the half extents are summed through |matrix|.
+ */
+BoundingBox Frustum::transform(const BoundingBox& box, const glm::mat4& matrix)
+{
+	glm::vec3 halfSize = 0.5f * glm::vec3(box.width, box.height, box.depth);
+	glm::vec3 center = glm::vec3(box.x, box.y, box.z) + halfSize;
+	glm::vec3 worldCenter = glm::vec3(matrix * glm::vec4(center, 1));
+	glm::mat3 linear(matrix);
+	glm::vec3 worldHalf = glm::vec3(
+			glm::abs(linear[0]) * halfSize.x + glm::abs(linear[1]) * halfSize.y + glm::abs(linear[2]) * halfSize.z);
+	glm::vec3 min = worldCenter - worldHalf;
+	return { min.x, min.y, min.z, 2 * worldHalf.x, 2 * worldHalf.y, 2 * worldHalf.z };
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+/**
+ * World space boxes stored as separate min and max arrays (SoA), so
+ * Frustum::cull() can test four boxes per instruction.
+ */
+struct BoxList
+{
+	std::vector<float> minX, minY, minZ;
+	std::vector<float> maxX, maxY, maxZ;
+
+	void clear();
+	void push_back(const BoundingBox& box);
+	void resize(std::size_t count);
+	void set(std::size_t i, const BoundingBox& box);
+	BoundingBox get(std::size_t i) const;
+	void removeSwap(std::size_t i);
+	std::size_t size() const;
+};
+
+/**
+ * The six planes of a view frustum, taken from a projection times view
+ * matrix. Boxes are tested against every plane with the corner that lies
+ * furthest along the plane normal, so a box is only rejected when it is
+ * completely behind one plane. Boxes near a frustum corner may pass even
+ * though they are outside, which only costs a draw.
+ */
+class Frustum
+{
+	public:
+		Frustum(const glm::mat4& viewProjection);
+		bool intersects(const BoundingBox& box) const;
+		std::size_t cull(const BoxList& boxes, std::vector<unsigned char>& visible) const;
+		std::size_t cullScalar(const BoxList& boxes, std::vector<unsigned char>& visible) const;
+
+		static BoundingBox transform(const BoundingBox& box, const glm::mat4& matrix);
+
+	private:
+		// xyz is the inward normal, w the distance. Not normalized, since
+		// only the sign of the distance matters.
+		glm::vec4 planes[6];
+};
@@ -0,0 +1,150 @@
+#ifndef NDEBUG
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+#include "GLDebug.h"
+
+namespace
+{
+	// Source, type and id together identify a message.
+	typedef std::tuple<GLenum, GLenum, GLuint> MessageKey;
+
+	struct MessageCount
+	{
+		GLenum severity;
+		unsigned int count;
+	};
+
+	std::map<MessageKey, MessageCount> messages;
+	bool callbackRegistered = false;
+
+	const char* sourceName(GLenum source)
+	{
+		switch (source)
+		{
+			case GL_DEBUG_SOURCE_API: return "API";
+			case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "WINDOW SYSTEM";
+			case GL_DEBUG_SOURCE_SHADER_COMPILER: return "SHADER COMPILER";
+			case GL_DEBUG_SOURCE_THIRD_PARTY: return "THIRD PARTY";
+			case GL_DEBUG_SOURCE_APPLICATION: return "APPLICATION";
+			default: return "OTHER";
+		}
+	}
+
+	const char* typeName(GLenum type)
+	{
+		switch (type)
+		{
+			case GL_DEBUG_TYPE_ERROR: return "ERROR";
+			case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "DEPRECATED";
+			case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "UNDEFINED BEHAVIOUR";
+			case GL_DEBUG_TYPE_PORTABILITY: return "PORTABILITY";
+			case GL_DEBUG_TYPE_PERFORMANCE: return "PERFORMANCE";
+			default: return "OTHER";
+		}
+	}
+
+	const char* severityName(GLenum severity)
+	{
+		switch (severity)
+		{
+			case GL_DEBUG_SEVERITY_HIGH: return "HIGH";
+			case GL_DEBUG_SEVERITY_MEDIUM: return "MEDIUM";
+			case GL_DEBUG_SEVERITY_LOW: return "LOW";
+			default: return "NOTIFICATION";
+		}
+	}
+
+	void APIENTRY messageCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
+			GLsizei, const GLchar* message, const void*)
+	{
+		auto inserted = messages.insert({ MessageKey(source, type, id), { severity, 0 } });
+		if (inserted.first->second.count++ == 0)
+		{
+			std::cerr << "GL " << severityName(severity) << " " << sourceName(source) << " "
+				<< typeName(type) << " " << id << ": " << message << std::endl;
+		}
+	}
+
+	bool hasExtension(const char* name)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (extension && std::strcmp(extension, name) == 0)
+				return true;
+		}
+		return false;
+	}
+}
+
+/**
+ * Registers the debug message callback. Call once after the loader has
+ * run. glad only loads glDebugMessageCallback for 4.3 contexts, so on
+ * older contexts that expose GL_KHR_debug it is loaded here instead.
+ */
+void GLDebug::init(GLADloadproc load)
+{
+	if (!glad_glDebugMessageCallback && hasExtension("GL_KHR_debug"))
+	{
+		glad_glDebugMessageCallback = reinterpret_cast<PFNGLDEBUGMESSAGECALLBACKPROC>(
+				load("glDebugMessageCallback"));
+		glad_glDebugMessageControl = reinterpret_cast<PFNGLDEBUGMESSAGECONTROLPROC>(
+				load("glDebugMessageControl"));
+	}
+
+	if (!glad_glDebugMessageCallback || !glad_glDebugMessageControl)
+	{
+		std::cerr << "KHR_debug is not available, falling back to glGetError." << std::endl;
+		return;
+	}
+
+	glEnable(GL_DEBUG_OUTPUT);
+	// Report on the thread and at the call that caused the message.
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glDebugMessageCallback(messageCallback, nullptr);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+	callbackRegistered = true;
+}
+
+/**
+ * Drains glGetError when there is no debug callback to report errors.
+ * Does nothing otherwise.
+ */
+void GLDebug::checkErrors(const char* context)
+{
+	if (callbackRegistered)
+		return;
+
+	GLenum status = glGetError();
+	while (status != GL_NO_ERROR)
+	{
+		messageCallback(GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_ERROR, status, GL_DEBUG_SEVERITY_HIGH,
+				0, context, nullptr);
+		status = glGetError();
+	}
+}
+
+/**
+ * Prints how many times each distinct message was reported.
+ */
+void GLDebug::printSummary()
+{
+	if (messages.empty())
+		return;
+
+	std::cerr << "GL debug messages:\n";
+	for (const auto& message : messages)
+	{
+		std::cerr << "  " << message.second.count << "x " << severityName(message.second.severity) << " "
+			<< sourceName(std::get<0>(message.first)) << " " << typeName(std::get<1>(message.first))
+			<< " " << std::get<2>(message.first) << "\n";
+	}
+}
+
+#endif
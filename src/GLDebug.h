@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glad/glad.h>
+
+/*
+ * OpenGL error reporting for debug builds. Building with NDEBUG defined
+ * (make RELEASE=1) compiles all of it away so nothing polls the driver
+ * for errors in the render loop.
+ *
+ * In debug builds init() registers a KHR_debug message callback when the
+ * context supports one. Each distinct message is printed the first time
+ * it arrives and counted after that. Without KHR_debug, checkErrors()
+ * falls back to draining glGetError.
+ */
+namespace GLDebug
+{
+#ifdef NDEBUG
+	inline void init(GLADloadproc) {}
+	inline void checkErrors(const char*) {}
+	inline void printSummary() {}
+#else
+	void init(GLADloadproc load);
+	void checkErrors(const char* context);
+	void printSummary();
+#endif
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * 64 bit FNV-1a. Unlike std::hash it gives the same value on every run
+ * and every build, so it can name and validate files on disk. Pass the
+ * previous result as hash to continue hashing more data.
+ */
+namespace Hash
+{
+	const std::uint64_t FNV_OFFSET = 14695981039346656037ull;
+	const std::uint64_t FNV_PRIME = 1099511628211ull;
+
+	inline std::uint64_t fnv1a(const void* data, std::size_t size, std::uint64_t hash = FNV_OFFSET)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	inline std::uint64_t fnv1a(const std::string& data, std::uint64_t hash = FNV_OFFSET)
+	{
+		return fnv1a(data.data(), data.size(), hash);
+	}
+}
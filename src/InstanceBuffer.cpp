@@ -0,0 +1,35 @@
+#include <glad/glad.h>
+
+#include "InstanceBuffer.h"
+
+InstanceBuffer::InstanceBuffer() :
+	capacity(0)
+{
+	glGenBuffers(1, &id);
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+	glDeleteBuffers(1, &id);
+}
+
+unsigned int InstanceBuffer::getId() const
+{
+	return id;
+}
+
+/**
+ * Replaces the contents of the buffer. The old storage is orphaned so
+ * the driver does not wait for draws of the previous frame that still
+ * read it.
+ */
+void InstanceBuffer::setData(const InstanceData* instances, std::size_t count)
+{
+	if (count > capacity)
+		capacity = count * 2;
+
+	glBindBuffer(GL_ARRAY_BUFFER, id);
+	glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), instances);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+#include "UniformBlocks.h"
+
+/**
+ * The InstanceData of every instanced draw in a frame, in one vertex
+ * buffer. Each draw points the instance attributes of its VertexArray at
+ * its own range with VertexArray::bindInstances().
+ */
+class InstanceBuffer
+{
+	public:
+		InstanceBuffer();
+		~InstanceBuffer();
+		unsigned int getId() const;
+		void setData(const InstanceData* instances, std::size_t count);
+
+	private:
+		unsigned int id;
+		std::size_t capacity;	// In instances.
+};
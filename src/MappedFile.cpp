@@ -0,0 +1,42 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const std::string& path) :
+	data(nullptr), size(0)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED)
+		{
+			data = static_cast<const char*>(mapped);
+			size = st.st_size;
+		}
+	}
+	// The mapping stays valid after the descriptor is closed.
+	close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if (data)
+		munmap(const_cast<char*>(data), size);
+}
+
+const char* MappedFile::getData() const
+{
+	return data;
+}
+
+std::size_t MappedFile::getSize() const
+{
+	return size;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+/**
+ * A read only mapping of a whole file. The pages are loaded on first
+ * access and the mapping is removed when the MappedFile is destroyed.
+ * getData() is null when the file could not be opened, mapped, or is
+ * empty.
+ */
+class MappedFile
+{
+	public:
+		MappedFile(const std::string& path);
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		const char* getData() const;
+		std::size_t getSize() const;
+
+	private:
+		const char* data;
+		std::size_t size;
+};
@@ -1,25 +1,48 @@
 #include <glad/glad.h>
+#include <vector>
 
 #include "Mesh.h"
 
-Mesh::Mesh(const aiMesh* mesh)
+Mesh::Mesh(const MeshData& data, VertexFormat format) :
+	Mesh(data.vertices.data(), data.vertices.size(), data.indices.data(), data.indices.size(), data.boundingBox,
+			format)
 {
-	extractDataFromMesh(mesh);
-	vertexArray = std::make_unique<VertexArray>(vertices, indices);
-	calcBoundingBox();
+}
+
+/**
+ * Uploads the vertices and indices straight from the given memory, which
+ * may be a mapped file. Nothing is kept on the CPU. A COMPACT mesh is
+ * converted into a temporary buffer first.
+ */
+Mesh::Mesh(const Vertex* vertices, std::size_t vertexCount,
+		const unsigned int* indices, std::size_t indexCount, const BoundingBox& boundingBox,
+		VertexFormat format) :
+	indexCount(indexCount), indexType(GL_UNSIGNED_INT), boundingBox(boundingBox), format(format), gpuSize(0)
+{
+	if (format == COMPACT)
+	{
+		uploadCompact(vertices, vertexCount, indices);
+		return;
+	}
+	vertexArray = std::make_unique<VertexArray>(vertices, vertexCount, indices, indexCount);
+	gpuSize = vertexCount * sizeof(Vertex) + indexCount * sizeof(unsigned int);
 }
 
 Mesh::~Mesh() {}
 
 /**
- * Fills the buffer with the vertex data from the mesh.
+ * Copies the vertex data out of an imported mesh.
  */
-void Mesh::extractDataFromMesh(const aiMesh* mesh)
+MeshData Mesh::extractDataFromMesh(const aiMesh* mesh)
 {
+	MeshData data;
+	std::vector<Vertex>& vertices = data.vertices;
+	std::vector<unsigned int>& indices = data.indices;
+
 	// First, extract all the vertex data, i.e. position, normal, etc.
 	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 	{
-		Vertex vertex;
+		Vertex vertex = {};
 
 		vertex.position.x = mesh->mVertices[i].x;
 		vertex.position.y = mesh->mVertices[i].y;
@@ -52,17 +75,50 @@ void Mesh::extractDataFromMesh(const aiMesh* mesh)
 			indices.push_back(face.mIndices[j]);
 		}
 	}	
+
+	data.boundingBox = calcBoundingBox(vertices);
+	return data;
 }
 
 void Mesh::draw() const
 {
+	setDequantization();
 	vertexArray->bind();
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+	glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
 	glBindVertexArray(0);
 }
 
-void Mesh::calcBoundingBox()
+/**
+ * Draws count indices starting at firstIndex, for meshes whose index
+ * buffer is laid out in ranges that make sense on their own.
+ */
+void Mesh::draw(std::size_t firstIndex, std::size_t count) const
 {
+	std::size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(unsigned int);
+	setDequantization();
+	vertexArray->bind();
+	glDrawElements(GL_TRIANGLES, count, indexType, reinterpret_cast<const void*>(firstIndex * indexSize));
+	glBindVertexArray(0);
+}
+
+/**
+ * Draws count instances whose InstanceData starts at instance first of
+ * instanceBufferId.
+ */
+void Mesh::drawInstanced(unsigned int instanceBufferId, std::size_t first, std::size_t count) const
+{
+	setDequantization();
+	vertexArray->bindInstances(instanceBufferId, first);
+	glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, 0, count);
+	glBindVertexArray(0);
+}
+
+BoundingBox Mesh::calcBoundingBox(const std::vector<Vertex>& vertices)
+{
+	BoundingBox boundingBox = {};
+	if (vertices.empty())
+		return boundingBox;
+
 	float minX = vertices[0].position.x;
 	float maxX = minX;
 	float minY = vertices[0].position.y;
@@ -87,9 +143,83 @@ void Mesh::calcBoundingBox()
 	boundingBox.width = glm::abs(maxX - minX);
 	boundingBox.height = glm::abs(maxY - minY);
 	boundingBox.depth = glm::abs(maxZ - minZ);
+	return boundingBox;
 }
 
 const BoundingBox& Mesh::getBoundingBox() const
 {
 	return boundingBox;
 }
+
+std::size_t Mesh::getGpuSize() const
+{
+	return gpuSize;
+}
+
+/**
+ * Quantises positions within the BoundingBox, packs normals
+ * octahedrally and narrows the indices when they fit in 16 bits.
+ */
+void Mesh::uploadCompact(const Vertex* vertices, std::size_t vertexCount, const unsigned int* indices)
+{
+	glm::vec3 min(boundingBox.x, boundingBox.y, boundingBox.z);
+	glm::vec3 size(boundingBox.width, boundingBox.height, boundingBox.depth);
+	std::vector<CompactVertex> compact(vertexCount);
+	for (std::size_t i = 0; i < vertexCount; i++)
+	{
+		glm::vec3 position = vertices[i].position - min;
+		for (int k = 0; k < 3; k++)
+		{
+			float fraction = size[k] > 0 ? glm::clamp(position[k] / size[k], 0.0f, 1.0f) : 0;
+			compact[i].position[k] = std::uint16_t(fraction * 65535 + 0.5f);
+		}
+		compact[i].position[3] = 0;
+
+		// Project onto the octahedron |x| + |y| + |z| = 1 and fold the
+		// lower half over the diagonals.
+		glm::vec3 n = vertices[i].normal;
+		float sum = glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+		glm::vec2 encoded = sum > 0 ? glm::vec2(n) / sum : glm::vec2(0);
+		if (sum > 0 && n.z < 0)
+		{
+			glm::vec2 sign(encoded.x >= 0 ? 1 : -1, encoded.y >= 0 ? 1 : -1);
+			encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * sign;
+		}
+		compact[i].normal[0] = std::int16_t(glm::round(glm::clamp(encoded.x, -1.0f, 1.0f) * 32767));
+		compact[i].normal[1] = std::int16_t(glm::round(glm::clamp(encoded.y, -1.0f, 1.0f) * 32767));
+	}
+
+	if (vertexCount <= 65536)
+	{
+		std::vector<std::uint16_t> shortIndices(indices, indices + indexCount);
+		vertexArray = std::make_unique<VertexArray>(compact.data(), vertexCount,
+				shortIndices.data(), sizeof(std::uint16_t), indexCount);
+		indexType = GL_UNSIGNED_SHORT;
+		gpuSize = vertexCount * sizeof(CompactVertex) + indexCount * sizeof(std::uint16_t);
+	}
+	else
+	{
+		vertexArray = std::make_unique<VertexArray>(compact.data(), vertexCount,
+				indices, sizeof(unsigned int), indexCount);
+		gpuSize = vertexCount * sizeof(CompactVertex) + indexCount * sizeof(unsigned int);
+	}
+}
+
+/**
+ * Sets the constant attributes vertex.glsl turns positions and normals
+ * back into floats with. For FULL vertices they change nothing.
+ */
+void Mesh::setDequantization() const
+{
+	if (format == COMPACT)
+	{
+		// w tells the shader the normal is octahedral.
+		glVertexAttrib4f(DEQUANTIZE_LOCATION, boundingBox.width, boundingBox.height, boundingBox.depth, 1);
+		glVertexAttrib4f(DEQUANTIZE_LOCATION + 1, boundingBox.x, boundingBox.y, boundingBox.z, 0);
+	}
+	else
+	{
+		glVertexAttrib4f(DEQUANTIZE_LOCATION, 1, 1, 1, 0);
+		glVertexAttrib4f(DEQUANTIZE_LOCATION + 1, 0, 0, 0, 0);
+	}
+}
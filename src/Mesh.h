@@ -1,3 +1,5 @@
+#pragma once
+
 #include <vector>
 #include <assimp/scene.h>
 #include <memory>
@@ -10,20 +12,57 @@ struct BoundingBox
 	float x, y, z, width, height, depth;
 };
 
+/**
+ * A mesh as it comes out of the importer, before it is uploaded.
+ */
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	BoundingBox boundingBox;
+};
+
 class Mesh
 {
 	public:
-		Mesh(const aiMesh* mesh);
+		/*
+		 * How the vertices are stored on the GPU. FULL uploads Vertex as
+		 * is. COMPACT uploads CompactVertex, dropping the texture
+		 * coordinates no shader reads, and 16 bit indices when there are
+		 * at most 65536 vertices.
+		 */
+		enum VertexFormat
+		{
+			FULL = 0,
+			COMPACT
+		};
+
+		// vertex.glsl reads the dequantisation scale and offset from
+		// these two generic attributes, which draw() sets as constants.
+		static const unsigned int DEQUANTIZE_LOCATION = 9;
+
+		Mesh(const MeshData& data, VertexFormat format = FULL);
+		Mesh(const Vertex* vertices, std::size_t vertexCount,
+				const unsigned int* indices, std::size_t indexCount, const BoundingBox& boundingBox,
+				VertexFormat format = FULL);
 		~Mesh();
 		void draw() const;
-		void extractDataFromMesh(const aiMesh* mesh);
+		void draw(std::size_t firstIndex, std::size_t count) const;
+		void drawInstanced(unsigned int instanceBufferId, std::size_t first, std::size_t count) const;
 		const BoundingBox& getBoundingBox() const;
+		std::size_t getGpuSize() const;
+
+		static MeshData extractDataFromMesh(const aiMesh* mesh);
+		static BoundingBox calcBoundingBox(const std::vector<Vertex>& vertices);
 
 	private:
-		std::vector<Vertex> vertices;
-		std::vector<unsigned int> indices;
+		std::size_t indexCount;
+		unsigned int indexType;
 		std::unique_ptr<VertexArray> vertexArray;
 		BoundingBox boundingBox;
+		VertexFormat format;
+		std::size_t gpuSize;	// Bytes of vertex and index buffer.
 
-		void calcBoundingBox();
+		void uploadCompact(const Vertex* vertices, std::size_t vertexCount, const unsigned int* indices);
+		void setDequantization() const;
 };
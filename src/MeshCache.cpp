@@ -0,0 +1,242 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "MeshCache.h"
+#include "Hash.h"
+
+const char* MeshCache::DIRECTORY = "meshCache";
+
+namespace
+{
+	const char MAGIC[4] = { 'M', 'E', 'S', 'H' };
+	// 2: meshes are welded and reordered by MeshOptimizer.
+	const std::uint32_t VERSION = 2;
+	// Blobs start on this boundary so the mapped arrays are aligned.
+	const std::uint64_t ALIGNMENT = 16;
+
+	struct Header
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint32_t importFlags;
+		std::uint32_t vertexSize;	// sizeof(Vertex) when written.
+		std::uint64_t meshCount;
+		std::uint64_t sourceSize;
+		std::int64_t sourceTime;
+		std::uint64_t sourceHash;
+	};
+
+	struct TableEntry
+	{
+		std::uint64_t vertexOffset;
+		std::uint64_t vertexCount;
+		std::uint64_t indexOffset;
+		std::uint64_t indexCount;
+		BoundingBox boundingBox;
+	};
+
+	struct SourceInfo
+	{
+		std::uint64_t size;
+		std::int64_t time;
+	};
+
+	bool getSourceInfo(const std::string& path, SourceInfo& info)
+	{
+		std::error_code error;
+		info.size = std::filesystem::file_size(path, error);
+		if (error)
+			return false;
+		info.time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+		return !error;
+	}
+
+	std::uint64_t hashFile(const std::string& path)
+	{
+		std::ifstream in(path, std::ios::binary);
+		std::vector<char> buffer(1 << 16);
+		std::uint64_t hash = Hash::FNV_OFFSET;
+		while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0)
+			hash = Hash::fnv1a(buffer.data(), in.gcount(), hash);
+		return hash;
+	}
+
+	std::uint64_t align(std::uint64_t offset)
+	{
+		return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	}
+}
+
+MeshCache::Entry::Entry(std::unique_ptr<MappedFile> file) :
+	file(std::move(file))
+{
+}
+
+MeshCache::Entry::~Entry() {}
+
+std::size_t MeshCache::Entry::getMeshCount() const
+{
+	return reinterpret_cast<const Header*>(file->getData())->meshCount;
+}
+
+/**
+ * Uploads one mesh straight from the mapped file. Must be called on the
+ * thread that owns the GL context.
+ */
+std::unique_ptr<Mesh> MeshCache::Entry::createMesh(std::size_t index, Mesh::VertexFormat format) const
+{
+	const char* data = file->getData();
+	const TableEntry& entry = reinterpret_cast<const TableEntry*>(data + sizeof(Header))[index];
+	return std::make_unique<Mesh>(
+			reinterpret_cast<const Vertex*>(data + entry.vertexOffset), entry.vertexCount,
+			reinterpret_cast<const unsigned int*>(data + entry.indexOffset), entry.indexCount,
+			entry.boundingBox, format);
+}
+
+/**
+ * Copies one mesh out of the mapped file, for processing on the CPU.
+ */
+MeshData MeshCache::Entry::getMeshData(std::size_t index) const
+{
+	const char* data = file->getData();
+	const TableEntry& entry = reinterpret_cast<const TableEntry*>(data + sizeof(Header))[index];
+	const Vertex* vertices = reinterpret_cast<const Vertex*>(data + entry.vertexOffset);
+	const unsigned int* indices = reinterpret_cast<const unsigned int*>(data + entry.indexOffset);
+	MeshData mesh;
+	mesh.vertices.assign(vertices, vertices + entry.vertexCount);
+	mesh.indices.assign(indices, indices + entry.indexCount);
+	mesh.boundingBox = entry.boundingBox;
+	return mesh;
+}
+
+/**
+ * Where the cache entry of a source file lives, relative to the working
+ * directory. The name includes a hash of the full path and the import
+ * flags, so files with the same name in different directories, or one
+ * file imported two ways, do not collide.
+ */
+std::string MeshCache::getCachePath(const std::string& sourcePath, unsigned int importFlags)
+{
+	std::uint64_t key = Hash::fnv1a(&importFlags, sizeof(importFlags), Hash::fnv1a(sourcePath));
+	char hash[20];
+	std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(key));
+	return std::string(DIRECTORY) + "/" + std::filesystem::path(sourcePath).stem().string() + "-" + hash + ".mesh";
+}
+
+/**
+ * Maps the cache entry of a source file. Returns null when there is no
+ * valid entry. Safe to call from any thread.
+ */
+std::unique_ptr<MeshCache::Entry> MeshCache::open(const std::string& sourcePath, unsigned int importFlags)
+{
+	SourceInfo source;
+	if (!getSourceInfo(sourcePath, source))
+		return nullptr;
+
+	std::string cachePath = getCachePath(sourcePath, importFlags);
+	auto file = std::make_unique<MappedFile>(cachePath);
+	const char* data = file->getData();
+	std::size_t size = file->getSize();
+	if (!data || size < sizeof(Header))
+		return nullptr;
+
+	Header header;
+	std::memcpy(&header, data, sizeof(Header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+			header.importFlags != importFlags || header.vertexSize != sizeof(Vertex) ||
+			header.sourceSize != source.size)
+		return nullptr;
+
+	if (header.sourceTime != source.time)
+	{
+		// Touched but maybe not changed. Compare the contents and
+		// remember the new time so the next run can skip the hash.
+		if (header.sourceHash != hashFile(sourcePath))
+			return nullptr;
+		std::fstream out(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+		out.seekp(offsetof(Header, sourceTime));
+		out.write(reinterpret_cast<const char*>(&source.time), sizeof(source.time));
+	}
+
+	std::uint64_t tableEnd = sizeof(Header) + header.meshCount * sizeof(TableEntry);
+	if (header.meshCount == 0 || tableEnd > size)
+		return nullptr;
+
+	const TableEntry* entries = reinterpret_cast<const TableEntry*>(data + sizeof(Header));
+	for (std::uint64_t i = 0; i < header.meshCount; i++)
+	{
+		const TableEntry& entry = entries[i];
+		if (entry.vertexOffset + entry.vertexCount * sizeof(Vertex) > size ||
+				entry.indexOffset + entry.indexCount * sizeof(unsigned int) > size)
+			return nullptr;
+	}
+
+	return std::make_unique<MeshCache::Entry>(std::move(file));
+}
+
+/**
+ * Writes the cache entry for a source file. The file is written under a
+ * temporary name and renamed, so a crash never leaves half an entry.
+ */
+bool MeshCache::save(const std::string& sourcePath, unsigned int importFlags, const std::vector<MeshData>& meshes)
+{
+	SourceInfo source;
+	if (meshes.empty() || !getSourceInfo(sourcePath, source))
+		return false;
+
+	std::error_code error;
+	std::filesystem::create_directories(DIRECTORY, error);
+
+	Header header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.importFlags = importFlags;
+	header.vertexSize = sizeof(Vertex);
+	header.meshCount = meshes.size();
+	header.sourceSize = source.size;
+	header.sourceTime = source.time;
+	header.sourceHash = hashFile(sourcePath);
+
+	std::vector<TableEntry> entries(meshes.size());
+	std::uint64_t offset = sizeof(Header) + entries.size() * sizeof(TableEntry);
+	for (std::size_t i = 0; i < meshes.size(); i++)
+	{
+		entries[i].vertexOffset = offset = align(offset);
+		entries[i].vertexCount = meshes[i].vertices.size();
+		offset += entries[i].vertexCount * sizeof(Vertex);
+		entries[i].indexOffset = offset = align(offset);
+		entries[i].indexCount = meshes[i].indices.size();
+		offset += entries[i].indexCount * sizeof(unsigned int);
+		entries[i].boundingBox = meshes[i].boundingBox;
+	}
+
+	std::string cachePath = getCachePath(sourcePath, importFlags);
+	std::string temporary = cachePath + ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(TableEntry));
+		const char zeros[ALIGNMENT] = {};
+		for (std::size_t i = 0; i < meshes.size(); i++)
+		{
+			out.write(zeros, entries[i].vertexOffset - out.tellp());
+			out.write(reinterpret_cast<const char*>(meshes[i].vertices.data()),
+					entries[i].vertexCount * sizeof(Vertex));
+			out.write(zeros, entries[i].indexOffset - out.tellp());
+			out.write(reinterpret_cast<const char*>(meshes[i].indices.data()),
+					entries[i].indexCount * sizeof(unsigned int));
+		}
+		if (!out)
+		{
+			std::cerr << "Failed to write mesh cache " << temporary << std::endl;
+			return false;
+		}
+	}
+	std::filesystem::rename(temporary, cachePath, error);
+	return !error;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "Mesh.h"
+#include "MappedFile.h"
+
+/*
+ * Imported meshes stored in a binary file so later runs skip the
+ * importer. A file holds a versioned header, a table with the counts and
+ * BoundingBox of every mesh, then the vertex and index arrays exactly as
+ * they are uploaded, so an Entry maps the file and hands the mapped pages
+ * straight to glBufferData.
+ *
+ * An entry belongs to one source file and set of import flags. It is
+ * valid while the source has the same size and modification time, or,
+ * if only the time changed, the same contents hash.
+ */
+namespace MeshCache
+{
+	extern const char* DIRECTORY;
+
+	/**
+	 * A valid cache file mapped into memory. Opening and reading it
+	 * needs no GL context, only createMesh() does.
+	 */
+	class Entry
+	{
+		public:
+			Entry(std::unique_ptr<MappedFile> file);
+			~Entry();
+			std::size_t getMeshCount() const;
+			std::unique_ptr<Mesh> createMesh(std::size_t index, Mesh::VertexFormat format = Mesh::FULL) const;
+			MeshData getMeshData(std::size_t index) const;
+
+		private:
+			std::unique_ptr<MappedFile> file;
+	};
+
+	std::string getCachePath(const std::string& sourcePath, unsigned int importFlags);
+	std::unique_ptr<Entry> open(const std::string& sourcePath, unsigned int importFlags);
+	bool save(const std::string& sourcePath, unsigned int importFlags, const std::vector<MeshData>& meshes);
+}
@@ -0,0 +1,143 @@
+#include <assimp/postprocess.h>     // Post processing flags
+
+#include "MeshGroup.h"
+#include "MeshSource.h"
+
+const unsigned int MeshGroup::DEFAULT_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals;
+
+/**
+ * Reads and uploads every mesh of the file right away.
+ */
+MeshGroup::MeshGroup(const std::string& path, unsigned int importFlags, Mesh::VertexFormat format) :
+	path(path), boundingBox()
+{
+	MeshSource source(path, importFlags);
+	for (std::size_t i = 0; i < source.getMeshCount(); i++)
+		meshes.push_back(source.createMesh(i, format));
+	calcBoundingBox();
+}
+
+/**
+ * Takes meshes that were already uploaded, for example a few at a time
+ * by the ResourceManager.
+ */
+MeshGroup::MeshGroup(const std::string& path, std::vector<std::unique_ptr<Mesh>> meshes) :
+	path(path), meshes(std::move(meshes)), boundingBox()
+{
+	calcBoundingBox();
+}
+
+MeshGroup::~MeshGroup() {}
+
+/**
+ * Assumes the shader is already in use and the model's uniforms are bound.
+ */
+void MeshGroup::draw() const
+{
+	for (const auto& mesh : meshes)
+	{
+		mesh->draw();
+	}
+}
+
+/**
+ * Draws only the meshes whose box, placed by model, intersects frustum.
+ * Returns how many were skipped. Groups of one mesh are drawn as is,
+ * since the Model was already tested with the same box.
+ */
+std::size_t MeshGroup::draw(const Frustum& frustum, const glm::mat4& model) const
+{
+	if (meshes.size() == 1)
+	{
+		meshes[0]->draw();
+		return 0;
+	}
+
+	std::size_t culled = 0;
+	for (const auto& mesh : meshes)
+	{
+		if (frustum.intersects(Frustum::transform(mesh->getBoundingBox(), model)))
+			mesh->draw();
+		else
+			culled++;
+	}
+	return culled;
+}
+
+/**
+ * Draws count instances of every mesh in one call per mesh. Assumes an
+ * INSTANCED shader is in use.
+ */
+void MeshGroup::drawInstanced(unsigned int instanceBufferId, std::size_t first, std::size_t count) const
+{
+	for (const auto& mesh : meshes)
+	{
+		mesh->drawInstanced(instanceBufferId, first, count);
+	}
+}
+
+/**
+ * Iterate over every mesh to calculate the bounding box of the whole group.
+ */
+void MeshGroup::calcBoundingBox()
+{
+	if (meshes.empty())
+		return;
+
+	float minX = meshes[0]->getBoundingBox().x;
+	float maxX = meshes[0]->getBoundingBox().x + meshes[0]->getBoundingBox().width;
+	float minY = meshes[0]->getBoundingBox().y;
+	float maxY = meshes[0]->getBoundingBox().y + meshes[0]->getBoundingBox().height;
+	float minZ = meshes[0]->getBoundingBox().z;
+	float maxZ = meshes[0]->getBoundingBox().z + meshes[0]->getBoundingBox().depth;
+
+	for (const auto& mesh : meshes)
+	{
+		minX = glm::min(minX, mesh->getBoundingBox().x);
+		maxX = glm::max(maxX, mesh->getBoundingBox().x + mesh->getBoundingBox().width);
+		
+		minY = glm::min(minY, mesh->getBoundingBox().y);
+		maxY = glm::max(maxY, mesh->getBoundingBox().y + mesh->getBoundingBox().height);
+		
+		minZ = glm::min(minZ, mesh->getBoundingBox().z);
+		maxZ = glm::max(maxZ, mesh->getBoundingBox().z + mesh->getBoundingBox().depth);
+	}
+
+	boundingBox.x = minX;
+	boundingBox.y = minY;
+	boundingBox.z = minZ;
+	boundingBox.width = glm::abs(maxX - minX);
+	boundingBox.height = glm::abs(maxY - minY);
+	boundingBox.depth = glm::abs(maxZ - minZ);
+}
+
+const BoundingBox& MeshGroup::getBoundingBox() const
+{
+	return boundingBox;
+}
+
+const std::string& MeshGroup::getPath() const
+{
+	return path;
+}
+
+/**
+ * 0 when the file could not be imported.
+ */
+std::size_t MeshGroup::getMeshCount() const
+{
+	return meshes.size();
+}
+
+/**
+ * Bytes of vertex and index buffers held by all meshes.
+ */
+std::size_t MeshGroup::getGpuSize() const
+{
+	std::size_t size = 0;
+	for (const auto& mesh : meshes)
+	{
+		size += mesh->getGpuSize();
+	}
+	return size;
+}
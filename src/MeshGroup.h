@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "Mesh.h"
+#include "Frustum.h"
+
+/**
+ * The meshes of one imported file, uploaded once. Models that show the
+ * same file share one MeshGroup through the ResourceManager and only add
+ * their own transform and FragmentSettings.
+ */
+class MeshGroup
+{
+	public:
+		MeshGroup(const std::string& path, unsigned int importFlags, Mesh::VertexFormat format = Mesh::FULL);
+		MeshGroup(const std::string& path, std::vector<std::unique_ptr<Mesh>> meshes);
+		~MeshGroup();
+		void draw() const;
+		std::size_t draw(const Frustum& frustum, const glm::mat4& model) const;
+		void drawInstanced(unsigned int instanceBufferId, std::size_t first, std::size_t count) const;
+		const BoundingBox& getBoundingBox() const;
+		const std::string& getPath() const;
+		std::size_t getMeshCount() const;
+		std::size_t getGpuSize() const;
+
+		static const unsigned int DEFAULT_IMPORT_FLAGS;
+
+	private:
+		std::string path;
+		std::vector<std::unique_ptr<Mesh>> meshes;
+		BoundingBox boundingBox;	// Covers every mesh.
+
+		void calcBoundingBox();
+};
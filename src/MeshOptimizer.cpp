@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "MeshOptimizer.h"
+#include "Hash.h"
+
+namespace
+{
+	// The LRU cache the Forsyth scores model. It is larger than real
+	// FIFO caches on purpose, the scores fall off smoothly with position.
+	const int FORSYTH_CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+	const int MAX_SCORED_VALENCE = 32;
+
+	struct ScoreTables
+	{
+		float cache[FORSYTH_CACHE_SIZE];
+		float valence[MAX_SCORED_VALENCE];
+
+		ScoreTables()
+		{
+			for (int i = 0; i < FORSYTH_CACHE_SIZE; i++)
+			{
+				// The three vertices of the last triangle score the same, so
+				// the next triangle does not favour one of its edges.
+				if (i < 3)
+					cache[i] = LAST_TRIANGLE_SCORE;
+				else
+					cache[i] = std::pow(1.0f - float(i - 3) / (FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+			valence[0] = 0;
+			for (int i = 1; i < MAX_SCORED_VALENCE; i++)
+				valence[i] = VALENCE_BOOST_SCALE * std::pow(float(i), -VALENCE_BOOST_POWER);
+		}
+	};
+
+	const ScoreTables& getScoreTables()
+	{
+		static const ScoreTables tables;
+		return tables;
+	}
+
+	/**
+	 * Vertices with few triangles left score higher so they are finished
+	 * off and leave the cache for good.
+	 */
+	float vertexScore(int cachePosition, unsigned int remaining)
+	{
+		if (remaining == 0)
+			return -1;
+		const ScoreTables& tables = getScoreTables();
+		float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0;
+		return score + tables.valence[std::min<unsigned int>(remaining, MAX_SCORED_VALENCE - 1)];
+	}
+
+	struct VertexHash
+	{
+		std::size_t operator()(const Vertex& vertex) const
+		{
+			return Hash::fnv1a(&vertex, sizeof(Vertex));
+		}
+	};
+
+	struct VertexEqual
+	{
+		bool operator()(const Vertex& a, const Vertex& b) const
+		{
+			return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+		}
+	};
+}
+
+/**
+ * Simulates a FIFO post transform cache of cacheSize vertices.
+ */
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const std::vector<unsigned int>& indices,
+		std::size_t vertexCount, unsigned int cacheSize)
+{
+	CacheStats stats = {};
+	if (indices.empty() || vertexCount == 0)
+		return stats;
+
+	// A vertex is in the cache while fewer than cacheSize misses happened
+	// since it was last loaded.
+	std::vector<std::size_t> loadedAt(vertexCount, 0);
+	std::size_t misses = 0;
+	for (unsigned int index : indices)
+	{
+		if (loadedAt[index] == 0 || misses - loadedAt[index] + 1 > cacheSize)
+		{
+			misses++;
+			loadedAt[index] = misses;
+		}
+	}
+
+	stats.acmr = float(misses) / (indices.size() / 3);
+	stats.atvr = float(misses) / vertexCount;
+	return stats;
+}
+
+/**
+ * Merges vertices whose position, normal and texture coordinates are
+ * bitwise identical. The importer makes one vertex per face corner, so
+ * without this no vertex is ever shared between triangles.
+ */
+void MeshOptimizer::weldVertices(MeshData& mesh)
+{
+	std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+	unique.reserve(mesh.vertices.size());
+	std::vector<unsigned int> remap(mesh.vertices.size());
+	std::vector<Vertex> welded;
+	welded.reserve(mesh.vertices.size());
+	for (std::size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		auto result = unique.emplace(mesh.vertices[i], welded.size());
+		if (result.second)
+			welded.push_back(mesh.vertices[i]);
+		remap[i] = result.first->second;
+	}
+
+	for (unsigned int& index : mesh.indices)
+		index = remap[index];
+	mesh.vertices = std::move(welded);
+}
+
+/**
+ * Reorders the triangles of indices for the post transform cache.
+ * Greedily emits the triangle whose vertices score highest, only
+ * rescoring vertices that entered or left the modelled cache, so it
+ * runs in time linear in the triangle count.
+ */
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, std::size_t vertexCount)
+{
+	std::size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// The triangles of every vertex. The first remaining[v] entries of
+	// a vertex's list are the triangles not emitted yet.
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (unsigned int index : indices)
+		remaining[index]++;
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (std::size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + remaining[v];
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> filled(vertexCount, 0);
+	for (std::size_t t = 0; t < triangleCount; t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = indices[t * 3 + k];
+			adjacency[offsets[v] + filled[v]++] = t;
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> score(vertexCount);
+	for (std::size_t v = 0; v < vertexCount; v++)
+		score[v] = vertexScore(-1, remaining[v]);
+	std::vector<float> triangleScore(triangleCount);
+	for (std::size_t t = 0; t < triangleCount; t++)
+		triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	std::vector<unsigned int> cache, newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	std::size_t nextUnemitted = 0;
+	long best = -1;
+	for (std::size_t step = 0; step < triangleCount; step++)
+	{
+		// No candidate next to the cache: continue with the first
+		// triangle not emitted yet.
+		if (best < 0)
+		{
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			best = nextUnemitted;
+		}
+
+		const unsigned int* triangle = &indices[best * 3];
+		output.insert(output.end(), triangle, triangle + 3);
+		emitted[best] = true;
+
+		// The triangle's vertices move to the front of the cache.
+		newCache.assign(triangle, triangle + 3);
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = triangle[k];
+			unsigned int* list = &adjacency[offsets[v]];
+			unsigned int* last = list + remaining[v] - 1;
+			*std::find(list, last + 1, unsigned(best)) = *last;
+			remaining[v]--;
+		}
+		for (unsigned int v : cache)
+		{
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache.push_back(v);
+		}
+
+		// Rescore everything that is in the cache or just fell out of it,
+		// along with their remaining triangles, and pick the best.
+		best = -1;
+		float bestScore = -1;
+		for (std::size_t i = 0; i < newCache.size(); i++)
+		{
+			unsigned int v = newCache[i];
+			cachePosition[v] = i < std::size_t(FORSYTH_CACHE_SIZE) ? int(i) : -1;
+			float newScore = vertexScore(cachePosition[v], remaining[v]);
+			float delta = newScore - score[v];
+			score[v] = newScore;
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				unsigned int t = adjacency[offsets[v] + j];
+				triangleScore[t] += delta;
+			}
+		}
+		for (std::size_t i = 0; i < newCache.size() && i < std::size_t(FORSYTH_CACHE_SIZE); i++)
+		{
+			unsigned int v = newCache[i];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				unsigned int t = adjacency[offsets[v] + j];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		if (newCache.size() > std::size_t(FORSYTH_CACHE_SIZE))
+			newCache.resize(FORSYTH_CACHE_SIZE);
+		std::swap(cache, newCache);
+	}
+
+	indices = std::move(output);
+}
+
+/**
+ * Reorders the vertices by their first use in the index buffer and
+ * drops vertices no triangle uses.
+ */
+void MeshOptimizer::optimizeVertexFetch(MeshData& mesh)
+{
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(mesh.vertices.size(), unused);
+	std::vector<Vertex> ordered;
+	ordered.reserve(mesh.vertices.size());
+	for (unsigned int& index : mesh.indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = ordered.size();
+			ordered.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+	mesh.vertices = std::move(ordered);
+}
+
+/**
+ * Welds, then reorders for the vertex cache and for fetching. The
+ * BoundingBox does not change.
+ */
+MeshOptimizer::Report MeshOptimizer::optimize(MeshData& mesh)
+{
+	Report report;
+	report.verticesBefore = mesh.vertices.size();
+	report.before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+	weldVertices(mesh);
+	optimizeVertexCache(mesh.indices, mesh.vertices.size());
+	optimizeVertexFetch(mesh);
+
+	report.verticesAfter = mesh.vertices.size();
+	report.after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+	return report;
+}
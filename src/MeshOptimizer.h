@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "Mesh.h"
+
+/*
+ * Reorders imported meshes for the GPU. Welding merges vertices with
+ * identical data, the vertex cache pass orders triangles so recently
+ * transformed vertices are reused (Tom Forsyth, "Linear-Speed Vertex
+ * Cache Optimisation", 2006) and the fetch pass orders vertices by first
+ * use so the vertex buffer is read front to back.
+ */
+namespace MeshOptimizer
+{
+	/**
+	 * How well the indices use a FIFO post transform cache. ACMR is
+	 * vertices transformed per triangle (0.5 at best, 3 at worst) and
+	 * ATVR is vertices transformed per vertex (1 at best).
+	 */
+	struct CacheStats
+	{
+		float acmr;
+		float atvr;
+	};
+
+	struct Report
+	{
+		std::size_t verticesBefore;
+		std::size_t verticesAfter;
+		CacheStats before;
+		CacheStats after;
+	};
+
+	// The FIFO size analyzeVertexCache() simulates by default, a common
+	// size for current GPUs.
+	const unsigned int ANALYZE_CACHE_SIZE = 16;
+
+	CacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, std::size_t vertexCount,
+			unsigned int cacheSize = ANALYZE_CACHE_SIZE);
+	void weldVertices(MeshData& mesh);
+	void optimizeVertexCache(std::vector<unsigned int>& indices, std::size_t vertexCount);
+	void optimizeVertexFetch(MeshData& mesh);
+	Report optimize(MeshData& mesh);
+}
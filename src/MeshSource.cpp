@@ -0,0 +1,125 @@
+#include <assimp/Importer.hpp>      // C++ importer interface
+#include <assimp/postprocess.h>     // Post processing flags
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+#include "MeshSource.h"
+#include "ObjParser.h"
+#include "MeshOptimizer.h"
+
+namespace
+{
+	// The import flags ObjParser reproduces.
+	const unsigned int OBJ_PARSER_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals;
+}
+
+/**
+ * Reads the meshes of path from the mesh cache, ObjParser or the
+ * importer, in that order. Freshly imported meshes are optimised before
+ * they are cached. pool, when given, parses OBJ files and optimises
+ * meshes in parallel.
+ */
+MeshSource::MeshSource(const std::string& path, unsigned int importFlags, ThreadPool* pool) :
+	cacheEntry(MeshCache::open(path, importFlags))
+{
+	if (cacheEntry)
+		return;
+
+	if (std::filesystem::path(path).extension() == ".obj" && (importFlags & ~OBJ_PARSER_FLAGS) == 0 &&
+			(importFlags & aiProcess_Triangulate))
+	{
+		MeshData mesh;
+		if (ObjParser::parse(path, mesh, pool))
+		{
+			meshes.push_back(std::move(mesh));
+			optimize(path, pool);
+			MeshCache::save(path, importFlags, meshes);
+			return;
+		}
+	}
+
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(path, importFlags);
+	if (!scene)
+	{
+		std::cerr <<  "Error loading " << path << ".\n" << importer.GetErrorString() << std::endl;
+		return;
+	}
+
+	extractDataFromNode(scene, scene->mRootNode, meshes);
+	optimize(path, pool);
+	MeshCache::save(path, importFlags, meshes);
+}
+
+MeshSource::~MeshSource() {}
+
+std::size_t MeshSource::getMeshCount() const
+{
+	return cacheEntry ? cacheEntry->getMeshCount() : meshes.size();
+}
+
+/**
+ * Uploads one mesh. Must be called on the thread that owns the GL
+ * context.
+ */
+std::unique_ptr<Mesh> MeshSource::createMesh(std::size_t index, Mesh::VertexFormat format) const
+{
+	if (cacheEntry)
+		return cacheEntry->createMesh(index, format);
+	return std::make_unique<Mesh>(meshes[index], format);
+}
+
+MeshData MeshSource::getMeshData(std::size_t index) const
+{
+	if (cacheEntry)
+		return cacheEntry->getMeshData(index);
+	return meshes[index];
+}
+
+/**
+ * Runs MeshOptimizer on every mesh, spread over pool when given, and
+ * prints how the vertex cache use changed.
+ */
+void MeshSource::optimize(const std::string& path, ThreadPool* pool)
+{
+	std::vector<MeshOptimizer::Report> reports(meshes.size());
+	auto optimizeMeshes = [this, &reports](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; i++)
+			reports[i] = MeshOptimizer::optimize(meshes[i]);
+	};
+	if (pool)
+		pool->parallelFor(meshes.size(), 1, optimizeMeshes);
+	else
+		optimizeMeshes(0, meshes.size());
+
+	// One write per file so lines from other workers do not interleave.
+	std::ostringstream out;
+	for (const MeshOptimizer::Report& report : reports)
+	{
+		out << "Optimised " << path << ": " << report.verticesBefore << " -> " << report.verticesAfter
+			<< " vertices, ACMR " << report.before.acmr << " -> " << report.after.acmr
+			<< ", ATVR " << report.before.atvr << " -> " << report.after.atvr << "\n";
+	}
+	std::cout << out.str() << std::flush;
+}
+
+/**
+ * Recursively process each node by first processing all meshes of the current node,
+ * then repeating the process for all children nodes.
+ */
+void MeshSource::extractDataFromNode(const aiScene* scene, const aiNode* node, std::vector<MeshData>& data)
+{
+	for (unsigned int i = 0; i < node->mNumMeshes; i++)
+	{
+		// aiNode contains indicies to index the objects in aiScene.
+		const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+		data.push_back(Mesh::extractDataFromMesh(mesh));
+	}
+
+	for (unsigned int i = 0; i < node->mNumChildren; i++)
+	{
+		// process all children nodes.
+		extractDataFromNode(scene, node->mChildren[i], data);
+	}
+}
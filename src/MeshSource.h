@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <assimp/scene.h>
+
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
+
+/**
+ * The meshes of one file read into memory but not uploaded. They come
+ * from the mesh cache when it has a valid entry, from ObjParser for
+ * plain OBJ files and from the importer otherwise. Reading needs no GL
+ * context, so a MeshSource can be made on a worker thread and uploaded
+ * later with createMesh().
+ */
+class MeshSource
+{
+	public:
+		MeshSource(const std::string& path, unsigned int importFlags, ThreadPool* pool = nullptr);
+		~MeshSource();
+		std::size_t getMeshCount() const;
+		std::unique_ptr<Mesh> createMesh(std::size_t index, Mesh::VertexFormat format = Mesh::FULL) const;
+		MeshData getMeshData(std::size_t index) const;
+
+	private:
+		std::unique_ptr<MeshCache::Entry> cacheEntry;
+		std::vector<MeshData> meshes;	// Empty when read from the cache.
+
+		void optimize(const std::string& path, ThreadPool* pool);
+		static void extractDataFromNode(const aiScene* scene, const aiNode* node, std::vector<MeshData>& data);
+};
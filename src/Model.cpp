@@ -1,167 +1,307 @@
 #include <glad/glad.h>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtx/euler_angles.hpp>
-#include <assimp/Importer.hpp>      // C++ importer interface
-#include <assimp/scene.h>           // Output data structure
-#include <assimp/postprocess.h>     // Post processing flags
 #include <iostream>
+#include <vector>
+#include <cstring>
+#include <chrono>
 
 #include "Model.h"
 
-Model::Model(const std::string &objPath) :
-	 modelMatrix(1.0f), m_rotate(0), m_scale(1), m_translate(0)
+/**
+ * Adds the model to scene, which holds its transform, boxes and fragment
+ * settings until the model is destroyed.
+ */
+Model::Model(Scene& scene, std::shared_ptr<const MeshGroup> meshGroup) :
+	 scene(scene), handle(scene.add(meshGroup.get(), meshGroup->getBoundingBox(), this)), meshGroup(meshGroup),
+	 waveSeed(0), waveCount(-1), waveMinFrequency(0), waveMaxFrequency(0),
+	 turbulenceSettings{0, 0, -1, 0}, bakeSettings{0, 0, -1, 0}, turbulenceCurrent(false),
+	 uniformBlock(), uniformVersion(0), uniformSlot(-1)
 {
-	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(objPath,
-			aiProcess_Triangulate | aiProcess_GenSmoothNormals);	
-	if (!scene)
-	{
-		std::cerr <<  "Error loading " << objPath << ".\n" << importer.GetErrorString() << std::endl;
-	}
-
-	extractDataFromNode(scene, scene->mRootNode);	
-
 	scaleToViewport();
-	// Scale model so that the longest side of its BoundingBox
-	// has a length of 1.
-//	m_scale = 1 / glm::max(boundingBox.width, glm::max(boundingBox.height, boundingBox.depth));
-//	update();
 }
 
-Model::~Model() {}
+Model::~Model()
+{
+	scene.remove(handle);
+}
+
+/**
+ * Draws the model. Remember to update() the model first.
+ * Assumes the shader is already in use and its ModelBlock is bound to
+ * ModelBlock::BINDING. With a frustum, meshes outside it are skipped and
+ * their count is returned.
+ */
+std::size_t Model::draw(UniformRing& uniformRing, const Frustum* frustum)
+{
+	bind(uniformRing);
+	if (frustum)
+		return meshGroup->draw(*frustum, getModelMatrix());
+	meshGroup->draw();
+	return 0;
+}
 
 /**
- * Recursively process each node by first processing all meshes of the current node,
- * then repeating the process for all children nodes.
+ * Binds the model's uniforms and textures without drawing, for geometry
+ * drawn in its place such as TerrainChunks.
  */
-void Model::extractDataFromNode(const aiScene* scene, const aiNode* node)
+void Model::bind(UniformRing& uniformRing)
 {
-	for (unsigned int i = 0; i < node->mNumMeshes; i++)
+	sendUniforms(uniformRing);
+	if (scene.getSettings(handle).noiseEffect == FragmentSettings::WATER && waveData)
 	{
-		// aiNode contains indicies to index the objects in aiScene.
-		const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.push_back(std::make_unique<Mesh>(mesh));
+		waveData->bind(GL_TEXTURE0);
 	}
-
-	for (unsigned int i = 0; i < node->mNumChildren; i++)
+	if (usesTurbulenceVolume())
 	{
-		// process all children nodes.
-		extractDataFromNode(scene, node->mChildren[i]);
+		turbulenceVolume->bind(GL_TEXTURE1);
 	}
-
 }
 
+/**
+ * Whether the model can be one instance of an instanced draw. Waves and
+ * baked turbulence are textures of their own model, which an instanced
+ * draw can not switch between instances.
+ */
+bool Model::canDrawInstanced() const
+{
+	return scene.getSettings(handle).noiseEffect != FragmentSettings::WATER && !usesTurbulenceVolume();
+}
 
 /**
- * Draws the model. Remember to update() the model first.
- * Assumes the shader is already in use.
+ * The instance of an object drawn with model and settings, straight from
+ * the Scene's arrays.
  */
-void Model::draw(const Shader& shader) const
+InstanceData Model::getInstanceData(const glm::mat4& model, const FragmentSettings& settings)
 {
-	sendUniforms(shader);
+	InstanceData instance;
+	instance.model = model;
+	instance.floats = glm::vec4(settings.persistence, settings.ringFrequency, settings.phaseSpeed, 0);
+	instance.ints = glm::ivec4(settings.noiseEffect, settings.octaveCount, settings.octaveStart,
+			settings.waveCenters);
+	return instance;
+}
 
-	for(auto &mesh : meshes)
-	{
-		mesh->draw();
-	}
+const MeshGroup& Model::getMeshGroup() const
+{
+	return *meshGroup;
+}
+
+Scene::Handle Model::getHandle() const
+{
+	return handle;
 }
 
 /**
- * Updates the model matrix. Should be called before draw().
+ * Changes show after the next Scene::update().
  */
-void Model::update()
+Transform& Model::getTransform()
 {
-	// Apply transformations
-	modelMatrix = glm::translate(modelMatrix, m_translate);
-	modelMatrix = modelMatrix * glm::eulerAngleXYZ(m_rotate.x, m_rotate.y, m_rotate.z);
-	modelMatrix = glm::scale(modelMatrix, glm::vec3(m_scale, m_scale, m_scale));
+	return scene.getTransform(handle);
+}
+
+Model::FragmentSettings& Model::getFragmentSettings()
+{
+	return scene.getSettings(handle);
+}
 
-	// Reset transformation values
-	m_translate = glm::vec3(0);
-	m_rotate = glm::vec3(0);
-	m_scale = 1;
+RenderState& Model::getRenderState()
+{
+	return scene.getRenderState(handle);
 }
 
 /**
- * Send uniforms to the shader.
+ * The model matrix as of the last Scene::update().
  */
-void Model::sendUniforms(const Shader& shader) const
+const glm::mat4& Model::getModelMatrix() const
 {
-	shader.setUniformMatrix4fv("model", modelMatrix);
-
-	shader.setUniform1i("effect", fragmentSettings.noiseEffect);
+	return scene.getMatrix(handle);
+}
 
-	shader.setUniform1f("persistence", fragmentSettings.persistence);
-	shader.setUniform1i("octaveCount", fragmentSettings.octaveCount);
-	shader.setUniform1i("octaveStart", fragmentSettings.octaveStart);
+/**
+ * The world space box around the model as of the last Scene::update().
+ */
+BoundingBox Model::getWorldBox() const
+{
+	return scene.getWorldBox(handle);
+}
 
-	shader.setUniform1f("ringFreq", fragmentSettings.ringFrequency);
+/**
+ * The defines for the fragment.glsl variant that draws this model's
+ * effect. With withOctaveCount the octave count is compiled in too, so
+ * each count gets its own program. instanced picks the variant that
+ * reads the model's settings from InstanceData.
+ */
+std::vector<std::string> Model::getShaderDefines(bool withOctaveCount, bool instanced) const
+{
+	static const char* effects[FragmentSettings::COUNT] = {
+		"EFFECT_GRASS",
+		"EFFECT_WOOD",
+		"EFFECT_WATER",
+		"EFFECT_BLACK_WHITE",
+		"EFFECT_NONE"};
 
-	shader.setUniform1i("waveCenters", fragmentSettings.waveCenters);
-	shader.setUniform1f("minFreq", fragmentSettings.minFrequency);
-	shader.setUniform1f("maxFreq", fragmentSettings.maxFrequency);
-	shader.setUniform1f("phaseSpeed", fragmentSettings.phaseSpeed);
+	const FragmentSettings& fragmentSettings = scene.getSettings(handle);
+	std::vector<std::string> defines = { effects[fragmentSettings.noiseEffect] };
+	bool turbulence = fragmentSettings.noiseEffect == FragmentSettings::GRASS ||
+		fragmentSettings.noiseEffect == FragmentSettings::WOOD ||
+		fragmentSettings.noiseEffect == FragmentSettings::BLACK_WHITE;
+	if (withOctaveCount && turbulence && !usesTurbulenceVolume())
+		defines.push_back("OCTAVE_COUNT " + std::to_string(fragmentSettings.octaveCount));
+	if (instanced)
+		defines.push_back("INSTANCED");
+	return defines;
 }
 
 /**
- * Rotates the model along each x,y, and z axis at the specified angles.
- * Input parameters are to be in radians. Remember to use the right-hand rule.
+ * The following code was adapted from
+ * Ken Perlin. 1985. An image synthesizer. SIGGRAPH Comput. Graph. 19, 3 (Jul. 1985), 287–296.
+ * DOI:10.1145/325165.325247
+ *
+ * Regenerates the wave centers and frequencies used by waves() in the
+ * fragment shader. They only depend on the seed and the wave settings,
+ * so nothing happens unless one of those changed since the last call.
  */
-void Model::rotate(const glm::vec3 &rotate)
+void Model::updateWaves(const Noise& noise)
 {
-	m_rotate = rotate;
+	const FragmentSettings& fragmentSettings = scene.getSettings(handle);
+	if (fragmentSettings.noiseEffect != FragmentSettings::WATER)
+		return;
+
+	int count = glm::max(fragmentSettings.waveCenters, 0);
+	float minFreq = fragmentSettings.minFrequency;
+	float maxFreq = fragmentSettings.maxFrequency;
+	if (waveData && waveSeed == noise.getSeed() && waveCount == count &&
+			waveMinFrequency == minFreq && waveMaxFrequency == maxFreq)
+		return;
+
+	// xyz is the center of the wave, w is its frequency.
+	std::vector<glm::vec4> waves(count);
+	for (int i = 0; i < count; i++)
+	{
+		glm::vec3 gradient;
+		noise.noise(float(i) * glm::vec3(100, 0, 0), gradient);
+		glm::vec3 center = glm::normalize(gradient);
+		float freq = noise.noise(center) * (maxFreq - minFreq) / maxFreq + minFreq;
+		waves[i] = glm::vec4(center, freq);
+	}
+
+	if (!waveData)
+		waveData = std::make_unique<TextureBuffer>(GL_RGBA32F);
+	// Buffer textures can not be empty.
+	if (waves.empty())
+		waves.push_back(glm::vec4(0));
+	waveData->setData(waves.data(), waves.size() * sizeof(glm::vec4));
+
+	waveSeed = noise.getSeed();
+	waveCount = count;
+	waveMinFrequency = minFreq;
+	waveMaxFrequency = maxFreq;
 }
 
-void Model::scale(const float scale)
+/**
+ * Uploads a finished turbulence bake, and starts a new one on pool when
+ * baked turbulence is on and the seed or the turbulence settings changed
+ * since the last bake. The job bakes from its own copy of noise, so the
+ * frame never waits for it. Until the volume matches the settings again
+ * the model sums the octaves itself.
+ *
+ * The volume repeats every power of two that covers the whole model, so
+ * the tiling is never visible on the model itself.
+ */
+void Model::updateTurbulence(const Noise& noise, ThreadPool& pool)
 {
-	m_scale = scale;
+	if (turbulenceBake.valid() && turbulenceBake.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		turbulenceVolume->upload(turbulenceBake.get());
+		turbulenceSettings = bakeSettings;
+	}
+
+	const FragmentSettings& fragmentSettings = scene.getSettings(handle);
+	TurbulenceSettings settings = { noise.getSeed(), fragmentSettings.persistence,
+		fragmentSettings.octaveCount, fragmentSettings.octaveStart };
+	turbulenceCurrent = turbulenceSettings == settings;
+	if (!fragmentSettings.bakedTurbulence || fragmentSettings.noiseEffect == FragmentSettings::WATER ||
+			fragmentSettings.noiseEffect == FragmentSettings::NONE)
+		return;
+	// A bake of older settings finishes first, then the next one starts.
+	if (turbulenceCurrent || turbulenceBake.valid())
+		return;
+
+	if (!turbulenceVolume)
+	{
+		const BoundingBox& boundingBox = scene.getLocalBox(handle);
+		float longest = glm::max(boundingBox.width, glm::max(boundingBox.height, boundingBox.depth));
+		int period = 1;
+		while (period < longest && period < 256)
+			period *= 2;
+		turbulenceVolume = std::make_unique<TurbulenceVolume>(period);
+	}
+	// The offset matches the one the shader passes to turbulence().
+	int period = turbulenceVolume->getPeriod();
+	auto bake = std::make_shared<std::packaged_task<std::vector<unsigned short>()>>([noise, period, settings]() {
+		return TurbulenceVolume::bake(noise, period, settings.persistence, settings.octaveCount,
+				settings.octaveStart, 25);
+	});
+	turbulenceBake = bake->get_future();
+	bakeSettings = settings;
+	pool.submit([bake]() { (*bake)(); });
 }
 
-void Model::translate(const glm::vec3 &translate)
+bool Model::usesTurbulenceVolume() const
 {
-	m_translate = translate;
+	return scene.getSettings(handle).bakedTurbulence && turbulenceCurrent;
 }
 
 /**
- * Iterate over every mesh to calculate the bounding box of the whole model.
- * Assumes the standard OpenGL viewport of -1 to 1.
+ * Packs the model matrix and fragment settings into a ModelBlock and
+ * binds this model's slot of the ring. The block is only uploaded when
+ * it differs from the one sent last time.
  */
-void Model::scaleToViewport()
+void Model::sendUniforms(UniformRing& uniformRing)
 {
-	float minX = meshes[0]->getBoundingBox().x;
-	float maxX = meshes[0]->getBoundingBox().x + meshes[0]->getBoundingBox().width;
-	float minY = meshes[0]->getBoundingBox().y;
-	float maxY = meshes[0]->getBoundingBox().y + meshes[0]->getBoundingBox().height;
-	float minZ = meshes[0]->getBoundingBox().z;
-	float maxZ = meshes[0]->getBoundingBox().z + meshes[0]->getBoundingBox().depth;
+	if (uniformSlot < 0)
+		uniformSlot = uniformRing.allocate();
+
+	const FragmentSettings& fragmentSettings = scene.getSettings(handle);
+	ModelBlock block = {};
+	block.model = getModelMatrix();
+	block.effect = fragmentSettings.noiseEffect;
+	block.persistence = fragmentSettings.persistence;
+	block.octaveCount = fragmentSettings.octaveCount;
+	block.octaveStart = fragmentSettings.octaveStart;
+	block.ringFreq = fragmentSettings.ringFrequency;
+	block.waveCenters = fragmentSettings.waveCenters;
+	block.phaseSpeed = fragmentSettings.phaseSpeed;
+	block.bakedTurbulence = usesTurbulenceVolume();
+	block.turbulencePeriod = usesTurbulenceVolume() ? turbulenceVolume->getPeriod() : 1;
 
-	for (const auto& mesh : meshes)
+	if (uniformVersion == 0 || std::memcmp(&block, &uniformBlock, sizeof(ModelBlock)) != 0)
 	{
-		minX = glm::min(minX, mesh->getBoundingBox().x);
-		maxX = glm::max(maxX, mesh->getBoundingBox().x + mesh->getBoundingBox().width);
-		
-		minY = glm::min(minY, mesh->getBoundingBox().y);
-		maxY = glm::max(maxY, mesh->getBoundingBox().y + mesh->getBoundingBox().height);
-		
-		minZ = glm::min(minZ, mesh->getBoundingBox().z);
-		maxZ = glm::max(maxZ, mesh->getBoundingBox().z + mesh->getBoundingBox().depth);
+		uniformBlock = block;
+		uniformVersion++;
 	}
+	uniformRing.write(uniformSlot, &uniformBlock, uniformVersion);
+	uniformRing.bind(uniformSlot, ModelBlock::BINDING);
+}
 
-	boundingBox.x = minX;
-	boundingBox.y = minY;
-	boundingBox.z = minZ;
-	boundingBox.width = glm::abs(maxX - minX);
-	boundingBox.height = glm::abs(maxY - minY);
-	boundingBox.depth = glm::abs(maxZ - minZ);
-
-	// Scale by the longest edge.
-	m_scale = 1 / glm::max(boundingBox.width, glm::max(boundingBox.height, boundingBox.depth));
+/**
+ * Scales and centers the model so its BoundingBox fits the standard
+ * OpenGL viewport of -1 to 1.
+ */
+void Model::scaleToViewport()
+{
+	const BoundingBox& boundingBox = scene.getLocalBox(handle);
+	// Scale by the longest edge. A box without extent keeps the identity.
+	float longest = glm::max(boundingBox.width, glm::max(boundingBox.height, boundingBox.depth));
+	if (!(longest > 0))
+		return;
+	float scale = 1 / longest;
 
 	// Put center of bounding at (0, 0, 0).
-	float xTrans = -(boundingBox.x + boundingBox.width*0.5f) * m_scale;
-	float yTrans = -(boundingBox.y + boundingBox.height*0.5f) * m_scale;
-	float zTrans = -(boundingBox.z + boundingBox.depth*0.5f) * m_scale;
-	m_translate = glm::vec3(xTrans, yTrans, zTrans);
-	update();
+	float xTrans = -(boundingBox.x + boundingBox.width*0.5f) * scale;
+	float yTrans = -(boundingBox.y + boundingBox.height*0.5f) * scale;
+	float zTrans = -(boundingBox.z + boundingBox.depth*0.5f) * scale;
+	Transform& transform = scene.getTransform(handle);
+	transform.setScale(scale);
+	transform.setPosition(glm::vec3(xTrans, yTrans, zTrans));
 }
 
@@ -3,64 +3,94 @@
 #include <string>
 #include <glm/glm.hpp>
 #include <memory>
+#include <future>
+
+#include <noise/Noise.h>
 
 #include "Shader.h"
-#include "Mesh.h"
+#include "MeshGroup.h"
+#include "TextureBuffer.h"
+#include "TurbulenceVolume.h"
+#include "ThreadPool.h"
+#include "UniformBlocks.h"
+#include "UniformRing.h"
+#include "Transform.h"
+#include "FragmentSettings.h"
+#include "Scene.h"
 
+/**
+ * One object of a Scene drawn with a MeshGroup. The scene holds what is
+ * touched every frame, the model what is only needed to draw it: its
+ * textures and ModelBlock slot.
+ */
 class Model
 {
 	public:
-		enum NoiseType
-		{
-			GRASS = 0,
-			WOOD,
-			WATER,
-			BLACK_WHITE,
-			NONE,
-			/*
-			 * COUNT is not a NoiseType. It stores how many enums there are.
-			 */
-			COUNT
-		};
+		typedef ::FragmentSettings FragmentSettings;
+		typedef FragmentSettings::NoiseType NoiseType;
 
-		struct FragmentSettings
-		{
-			NoiseType noiseEffect;
+		Model(Scene& scene, std::shared_ptr<const MeshGroup> meshGroup);
+		~Model();
+		std::size_t draw(UniformRing& uniformRing, const Frustum* frustum = nullptr);
+		void bind(UniformRing& uniformRing);
+		bool canDrawInstanced() const;
+		const MeshGroup& getMeshGroup() const;
+		Scene::Handle getHandle() const;
+		Transform& getTransform();
+		FragmentSettings& getFragmentSettings();
+		RenderState& getRenderState();
+		BoundingBox getWorldBox() const;
+		const glm::mat4& getModelMatrix() const;
+		std::vector<std::string> getShaderDefines(bool withOctaveCount, bool instanced = false) const;
+		void updateWaves(const Noise& noise);
+		void updateTurbulence(const Noise& noise, ThreadPool& pool);
+
+		static InstanceData getInstanceData(const glm::mat4& model, const FragmentSettings& settings);
 
-			// Turbulence parameters.
+	private:
+		// What a turbulence volume is baked from.
+		struct TurbulenceSettings
+		{
+			int seed;
 			float persistence;
 			int octaveCount;
 			int octaveStart;
 
-			// Wood parameters.
-			float ringFrequency;
-
-			// Wave parameters
-			int waveCenters;
-			float minFrequency;
-			float maxFrequency;
-			float phaseSpeed;
+			bool operator==(const TurbulenceSettings& other) const
+			{
+				return seed == other.seed && persistence == other.persistence &&
+					octaveCount == other.octaveCount && octaveStart == other.octaveStart;
+			}
 		};
 
-		Model(const std::string &objPath);
-		~Model();
-		void draw(const Shader& shader) const;
-		void update();
-		void rotate(const glm::vec3 &rotate);
-		void scale(float scale);
-		void translate(const glm::vec3 &translate);
-		FragmentSettings fragmentSettings;
+		// The model's transform, boxes and settings live in the scene.
+		Scene& scene;
+		Scene::Handle handle;
+		// Shared with every other Model of the same file.
+		std::shared_ptr<const MeshGroup> meshGroup;
 
-	private:
-		std::vector<std::unique_ptr<Mesh>> meshes;
+		// Wave centers and frequencies, and the settings they were made with.
+		std::unique_ptr<TextureBuffer> waveData;
+		int waveSeed;
+		int waveCount;
+		float waveMinFrequency;
+		float waveMaxFrequency;
+
+		// Baked turbulence and the settings it was made with, then the bake
+		// running on the pool and the settings it was started with. The
+		// volume is only sampled while its settings are the current ones.
+		std::unique_ptr<TurbulenceVolume> turbulenceVolume;
+		TurbulenceSettings turbulenceSettings;
+		std::future<std::vector<unsigned short>> turbulenceBake;
+		TurbulenceSettings bakeSettings;
+		bool turbulenceCurrent;
 
-		BoundingBox boundingBox;
-		glm::mat4 modelMatrix;
-		glm::vec3 m_rotate;			// how much to rotate along each axis
-		float m_scale;				// scale to apply to model
-		glm::vec3 m_translate;		// translation vector
+		// The ModelBlock last handed to the ring, its version and its slot.
+		ModelBlock uniformBlock;
+		unsigned int uniformVersion;
+		int uniformSlot;
 
-		void sendUniforms(const Shader& shader) const;
-		void extractDataFromNode(const aiScene* scene, const aiNode* node);
+		bool usesTurbulenceVolume() const;
+		void sendUniforms(UniformRing& uniformRing);
 		void scaleToViewport();
 };
@@ -0,0 +1,317 @@
+#include <charconv>
+#include <cstring>
+#include <vector>
+
+#include "ObjParser.h"
+#include "MappedFile.h"
+
+namespace
+{
+	// Ranges smaller than this are not worth a job of their own.
+	const std::size_t MIN_RANGE_SIZE = 1 << 16;
+
+	// Zero based indices of one face corner, -1 when absent.
+	struct Corner
+	{
+		int position;
+		int texture;
+		int normal;
+	};
+
+	// Everything found in one line range, in file order.
+	struct Chunk
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> textures;
+		std::vector<Corner> corners;
+		std::vector<unsigned int> faceSizes;	// Corners per face.
+		bool failed = false;
+	};
+
+	bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p < end && isSpace(*p))
+			p++;
+		return p;
+	}
+
+	bool parseFloats(const char*& p, const char* end, float* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			p = skipSpaces(p, end);
+			// from_chars does not accept a leading plus.
+			if (p < end && *p == '+')
+				p++;
+			std::from_chars_result result = std::from_chars(p, end, out[i]);
+			if (result.ec != std::errc())
+				return false;
+			p = result.ptr;
+		}
+		return true;
+	}
+
+	/**
+	 * Reads a one based OBJ index. Relative (negative) indices depend on
+	 * how many elements earlier ranges read, so they are not supported.
+	 */
+	bool parseIndex(const char*& p, const char* end, int& index)
+	{
+		std::from_chars_result result = std::from_chars(p, end, index);
+		if (result.ec != std::errc() || index <= 0)
+			return false;
+		p = result.ptr;
+		index--;
+		return true;
+	}
+
+	bool parseFace(const char* p, const char* end, Chunk& chunk)
+	{
+		unsigned int count = 0;
+		while (true)
+		{
+			p = skipSpaces(p, end);
+			if (p >= end || *p == '\r' || *p == '#')
+				break;
+
+			Corner corner = { -1, -1, -1 };
+			if (!parseIndex(p, end, corner.position))
+				return false;
+			if (p < end && *p == '/')
+			{
+				p++;
+				if (p < end && *p != '/' && !parseIndex(p, end, corner.texture))
+					return false;
+				if (p < end && *p == '/')
+				{
+					p++;
+					if (!parseIndex(p, end, corner.normal))
+						return false;
+				}
+			}
+			if (p < end && !isSpace(*p) && *p != '\r')
+				return false;
+			chunk.corners.push_back(corner);
+			count++;
+		}
+		if (count < 3)
+			return false;
+		chunk.faceSizes.push_back(count);
+		return true;
+	}
+
+	/**
+	 * Parses every line that starts in [begin, end).
+	 */
+	void parseRange(const char* begin, const char* end, Chunk& chunk)
+	{
+		for (const char* line = begin; line < end; )
+		{
+			const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+			if (!lineEnd)
+				lineEnd = end;
+
+			const char* p = skipSpaces(line, lineEnd);
+			bool ok = true;
+			if (lineEnd - p >= 2 && p[0] == 'v' && isSpace(p[1]))
+			{
+				glm::vec3 position;
+				ok = parseFloats(++p, lineEnd, &position.x, 3);
+				chunk.positions.push_back(position);
+			}
+			else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2]))
+			{
+				glm::vec3 normal;
+				ok = parseFloats(p += 2, lineEnd, &normal.x, 3);
+				chunk.normals.push_back(normal);
+			}
+			else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2]))
+			{
+				// A third texture coordinate is ignored, as the Vertex has two.
+				glm::vec2 texture;
+				ok = parseFloats(p += 2, lineEnd, &texture.x, 2);
+				chunk.textures.push_back(texture);
+			}
+			else if (lineEnd - p >= 2 && p[0] == 'f' && isSpace(p[1]))
+			{
+				ok = parseFace(p + 1, lineEnd, chunk);
+			}
+			// Anything else (comments, o, g, s, usemtl, mtllib) is skipped.
+
+			if (!ok)
+			{
+				chunk.failed = true;
+				return;
+			}
+			line = lineEnd + 1;
+		}
+	}
+
+	/**
+	 * Splits [data, data + size) into count ranges that each start at
+	 * the beginning of a line.
+	 */
+	std::vector<const char*> splitLines(const char* data, std::size_t size, std::size_t count)
+	{
+		const char* end = data + size;
+		std::vector<const char*> bounds = { data };
+		for (std::size_t i = 1; i < count; i++)
+		{
+			const char* p = std::max(data + size * i / count, bounds.back());
+			const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+			bounds.push_back(newline ? newline + 1 : end);
+		}
+		bounds.push_back(end);
+		return bounds;
+	}
+
+	template<typename T>
+	void append(std::vector<T>& to, const std::vector<T>& from)
+	{
+		to.insert(to.end(), from.begin(), from.end());
+	}
+
+	/**
+	 * Averages the normals of the triangles around every position, as
+	 * aiProcess_GenSmoothNormals does.
+	 */
+	std::vector<glm::vec3> smoothNormals(const std::vector<glm::vec3>& positions,
+			const std::vector<Corner>& corners, const std::vector<unsigned int>& faceSizes)
+	{
+		std::vector<glm::vec3> normals(positions.size(), glm::vec3(0));
+		std::size_t first = 0;
+		for (unsigned int faceSize : faceSizes)
+		{
+			const Corner* face = &corners[first];
+			for (unsigned int i = 1; i + 1 < faceSize; i++)
+			{
+				const glm::vec3& a = positions[face[0].position];
+				const glm::vec3& b = positions[face[i].position];
+				const glm::vec3& c = positions[face[i + 1].position];
+				glm::vec3 normal = glm::cross(b - a, c - a);
+				float length = glm::length(normal);
+				if (length == 0)
+					continue;
+				normal /= length;
+				normals[face[0].position] += normal;
+				normals[face[i].position] += normal;
+				normals[face[i + 1].position] += normal;
+			}
+			first += faceSize;
+		}
+		for (glm::vec3& normal : normals)
+		{
+			float length = glm::length(normal);
+			if (length > 0)
+				normal /= length;
+		}
+		return normals;
+	}
+}
+
+/**
+ * Reads the OBJ file at path into mesh. With a pool, line ranges are
+ * parsed on its workers. Returns false, with mesh in an unspecified
+ * state, when the file can not be read or uses anything this reader
+ * does not support.
+ */
+bool ObjParser::parse(const std::string& path, MeshData& mesh, ThreadPool* pool)
+{
+	MappedFile file(path);
+	if (!file.getData())
+		return false;
+
+	std::size_t rangeCount = pool ? pool->getThreadCount() + 1 : 1;
+	rangeCount = std::max<std::size_t>(1, std::min(rangeCount, file.getSize() / MIN_RANGE_SIZE));
+	std::vector<const char*> bounds = splitLines(file.getData(), file.getSize(), rangeCount);
+	std::vector<Chunk> chunks(rangeCount);
+	auto parseRanges = [&bounds, &chunks](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; i++)
+			parseRange(bounds[i], bounds[i + 1], chunks[i]);
+	};
+	if (pool && rangeCount > 1)
+		pool->parallelFor(rangeCount, 1, parseRanges);
+	else
+		parseRanges(0, rangeCount);
+
+	// Indices are absolute, so the ranges only need to be joined in order.
+	Chunk all;
+	for (const Chunk& chunk : chunks)
+	{
+		if (chunk.failed)
+			return false;
+		append(all.positions, chunk.positions);
+		append(all.normals, chunk.normals);
+		append(all.textures, chunk.textures);
+		append(all.corners, chunk.corners);
+		append(all.faceSizes, chunk.faceSizes);
+	}
+	if (all.faceSizes.empty())
+		return false;
+
+	bool missingNormals = false;
+	for (const Corner& corner : all.corners)
+	{
+		if (corner.position >= int(all.positions.size()) || corner.texture >= int(all.textures.size()) ||
+				corner.normal >= int(all.normals.size()))
+			return false;
+		missingNormals |= corner.normal < 0;
+	}
+	std::vector<glm::vec3> generatedNormals;
+	if (missingNormals)
+		generatedNormals = smoothNormals(all.positions, all.corners, all.faceSizes);
+
+	// One Vertex per distinct corner. The vertices made for a position are
+	// chained from head[position] through next, so finding an existing
+	// one only compares the corners that share its position.
+	std::vector<int> head(all.positions.size(), -1);
+	std::vector<int> next;
+	std::vector<Corner> made;
+	std::vector<unsigned int> cornerVertex(all.corners.size());
+	mesh.vertices.clear();
+	mesh.vertices.reserve(all.positions.size());
+	for (std::size_t i = 0; i < all.corners.size(); i++)
+	{
+		const Corner& corner = all.corners[i];
+		int found = head[corner.position];
+		while (found >= 0 && (made[found].texture != corner.texture || made[found].normal != corner.normal))
+			found = next[found];
+		if (found < 0)
+		{
+			Vertex vertex = {};
+			vertex.position = all.positions[corner.position];
+			vertex.normal = corner.normal >= 0 ? all.normals[corner.normal] : generatedNormals[corner.position];
+			if (corner.texture >= 0)
+				vertex.texture = all.textures[corner.texture];
+			found = mesh.vertices.size();
+			mesh.vertices.push_back(vertex);
+			made.push_back(corner);
+			next.push_back(head[corner.position]);
+			head[corner.position] = found;
+		}
+		cornerVertex[i] = found;
+	}
+
+	// Polygons become triangle fans.
+	mesh.indices.clear();
+	std::size_t first = 0;
+	for (unsigned int faceSize : all.faceSizes)
+	{
+		for (unsigned int i = 1; i + 1 < faceSize; i++)
+		{
+			mesh.indices.push_back(cornerVertex[first]);
+			mesh.indices.push_back(cornerVertex[first + i]);
+			mesh.indices.push_back(cornerVertex[first + i + 1]);
+		}
+		first += faceSize;
+	}
+
+	mesh.boundingBox = Mesh::calcBoundingBox(mesh.vertices);
+	return true;
+}
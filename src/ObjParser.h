@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include "Mesh.h"
+#include "ThreadPool.h"
+
+/*
+ * A reader for the Wavefront OBJ files Blender exports, much faster than
+ * the generic importer. The file is mapped, split into line ranges that
+ * are parsed in parallel with std::from_chars, and the v/vt/vn corners
+ * of the faces are merged into one Vertex per distinct corner.
+ *
+ * The result matches an import with aiProcess_Triangulate and
+ * aiProcess_GenSmoothNormals: polygons are split into fans and corners
+ * without a normal get the average normal of the triangles around their
+ * position. Every object of the file ends up in one MeshData. Files it
+ * does not handle, for example with relative indices, make parse()
+ * return false so the caller can fall back to the importer.
+ */
+namespace ObjParser
+{
+	bool parse(const std::string& path, MeshData& mesh, ThreadPool* pool = nullptr);
+}
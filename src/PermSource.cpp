@@ -0,0 +1,120 @@
+#include <cstdint>
+
+#include "PermSource.h"
+
+PermSource::PermSource(Type type, const Noise& noise) :
+	type(type), noise(noise), textureId(0)
+{
+	if (type != TEXTURE)
+		return;
+
+	std::uint8_t table[256];
+	for (int i = 0; i < 256; i++)
+		table[i] = noise.getPerm()[i];
+
+	glGenTextures(1, &textureId);
+	glBindTexture(GL_TEXTURE_1D, textureId);
+	// Integer textures can not be filtered.
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAX_LEVEL, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage1D(GL_TEXTURE_1D, 0, GL_R8UI, 256, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, table);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_1D, 0);
+}
+
+PermSource::~PermSource()
+{
+	if (textureId)
+		glDeleteTextures(1, &textureId);
+}
+
+PermSource::Type PermSource::getType() const
+{
+	return type;
+}
+
+/**
+ * The define fragment.glsl needs to read from this source.
+ */
+const char* PermSource::getDefine() const
+{
+	switch (type)
+	{
+		case TEXTURE: return "PERM_TEXTURE";
+		case HASH: return "PERM_HASH";
+		default: return "PERM_UNIFORM";
+	}
+}
+
+/**
+ * Sets the uniforms for this source. The shader must be in use.
+ */
+void PermSource::setUniforms(const Shader& shader) const
+{
+	// Variants without any noise have no permutation at all.
+	const char* uniform = type == TEXTURE ? "permTexture" : type == HASH ? "permKey" : "permTable";
+	if (!shader.hasUniform(uniform))
+		return;
+
+	switch (type)
+	{
+		case TEXTURE:
+			shader.setUniform1i("permTexture", TEXTURE_UNIT);
+			break;
+		case HASH:
+			shader.setUniform1ui("permKey", noise.getHashKey());
+			break;
+		default:
+			shader.setUniform1iv("permTable", Noise::PERM_SIZE, noise.getPerm());
+			break;
+	}
+}
+
+/**
+ * Binds the permutation texture, if this source has one.
+ */
+void PermSource::bind() const
+{
+	if (textureId)
+	{
+		glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_1D, textureId);
+	}
+}
+
+const char* PermSource::getName(Type type)
+{
+	switch (type)
+	{
+		case TEXTURE: return "texture";
+		case HASH: return "hash";
+		default: return "uniform";
+	}
+}
+
+/**
+ * Reads a Type from its getName(). Returns false for unknown names.
+ */
+bool PermSource::parse(const std::string& name, Type& type)
+{
+	for (int i = 0; i < COUNT; i++)
+	{
+		if (name == getName(static_cast<Type>(i)))
+		{
+			type = static_cast<Type>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * The permutation a Noise must use to agree with the shader.
+ */
+Noise::Permutation PermSource::getPermutation(Type type)
+{
+	return type == HASH ? Noise::HASHED : Noise::SHUFFLED;
+}
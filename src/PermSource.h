@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+
+#include <noise/Noise.h>
+
+#include "Shader.h"
+
+/**
+ * Where fragment.glsl reads the noise permutation table from.
+ *
+ * UNIFORM is the original int[512] uniform array. TEXTURE reads a 256
+ * texel R8UI texture with texelFetch. HASH computes Noise::hash() in the
+ * shader with no table at all, which needs a Noise built with
+ * Noise::HASHED so the CPU uses the same permutation.
+ */
+
+class PermSource
+{
+	public:
+		enum Type
+		{
+			UNIFORM = 0,
+			TEXTURE,
+			HASH,
+			/*
+			 * COUNT is not a Type. It stores how many enums there are.
+			 */
+			COUNT
+		};
+
+		// The texture unit TEXTURE binds to.
+		static const int TEXTURE_UNIT = 2;
+
+		PermSource(Type type, const Noise& noise);
+		~PermSource();
+		Type getType() const;
+		const char* getDefine() const;
+		void setUniforms(const Shader& shader) const;
+		void bind() const;
+
+		static const char* getName(Type type);
+		static bool parse(const std::string& name, Type& type);
+		static Noise::Permutation getPermutation(Type type);
+
+	private:
+		Type type;
+		const Noise& noise;
+		unsigned int textureId;
+};
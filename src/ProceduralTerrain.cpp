@@ -0,0 +1,184 @@
+#include <glad/glad.h>
+#include <cmath>
+
+#include "ProceduralTerrain.h"
+
+namespace
+{
+	// Each level reaches this many of its node sizes from the camera.
+	// Twice the node size or more keeps every node's children within
+	// one level of their neighbours.
+	const float RANGE_FACTOR = 3.0f;
+	// Morphing runs over the last part of a level's range.
+	const float MORPH_START = 0.7f;
+}
+
+/**
+ * Builds the grid patch, a unit square of GRID_SIZE by GRID_SIZE quads
+ * in the xz plane. Its indices are stored a quadrant at a time so each
+ * quadrant can be drawn on its own.
+ */
+ProceduralTerrain::ProceduralTerrain(float leafSize) :
+	settings({ 4.0f, 0.02f, 0.5f, 6, 0.1f }), leafSize(leafSize)
+{
+	for (int l = 0; l < LEVEL_COUNT; l++)
+		ranges[l] = leafSize * (1 << l) * RANGE_FACTOR;
+
+	MeshData data;
+	for (int z = 0; z <= GRID_SIZE; z++)
+	{
+		for (int x = 0; x <= GRID_SIZE; x++)
+		{
+			Vertex vertex = {};
+			vertex.position = glm::vec3(float(x) / GRID_SIZE, 0, float(z) / GRID_SIZE);
+			vertex.normal = glm::vec3(0, 1, 0);
+			vertex.texture = glm::vec2(vertex.position.x, vertex.position.z);
+			data.vertices.push_back(vertex);
+		}
+	}
+	const int half = GRID_SIZE / 2;
+	for (int quarter = 0; quarter < 4; quarter++)
+	{
+		int startX = (quarter & 1) * half;
+		int startZ = (quarter >> 1) * half;
+		for (int z = startZ; z < startZ + half; z++)
+		{
+			for (int x = startX; x < startX + half; x++)
+			{
+				unsigned int a = z * (GRID_SIZE + 1) + x;
+				unsigned int b = a + 1;
+				unsigned int c = a + GRID_SIZE + 1;
+				unsigned int d = c + 1;
+				data.indices.insert(data.indices.end(), { a, c, d, a, d, b });
+			}
+		}
+	}
+	data.boundingBox = Mesh::calcBoundingBox(data.vertices);
+	patch = std::make_unique<Mesh>(data);
+}
+
+ProceduralTerrain::~ProceduralTerrain() {}
+
+/**
+ * Selects the nodes around cameraPosition and draws them. shader must
+ * be a PROCEDURAL_TERRAIN variant and already in use. Nodes outside
+ * frustum are skipped when one is given.
+ */
+ProceduralTerrain::Stats ProceduralTerrain::draw(const Shader& shader, const glm::vec3& cameraPosition,
+		const Frustum* frustum)
+{
+	selection.clear();
+	float maxHeight = getMaxHeight();
+	int top = LEVEL_COUNT - 1;
+	float rootSize = leafSize * (1 << top);
+	glm::vec2 camera(cameraPosition.x, cameraPosition.z);
+	glm::ivec2 first = glm::ivec2(glm::floor((camera - ranges[top]) / rootSize));
+	glm::ivec2 last = glm::ivec2(glm::floor((camera + ranges[top]) / rootSize));
+	for (int z = first.y; z <= last.y; z++)
+	{
+		for (int x = first.x; x <= last.x; x++)
+			select(glm::vec2(x, z) * rootSize, top, cameraPosition, frustum, maxHeight);
+	}
+
+	auto found = uniforms.find(&shader);
+	if (found == uniforms.end())
+	{
+		Uniforms resolved;
+		resolved.shape = shader.getUniform<glm::vec4>("terrainShape");
+		resolved.octaves = shader.getUniform<int>("terrainOctaves");
+		resolved.node = shader.getUniform<glm::vec4>("terrainNode");
+		resolved.morph = shader.getUniform<glm::vec4>("terrainMorph");
+		found = uniforms.emplace(&shader, resolved).first;
+	}
+	const Uniforms& handles = found->second;
+	shader.setUniform(handles.shape,
+			glm::vec4(settings.height, settings.frequency, settings.persistence, settings.textureScale));
+	shader.setUniform(handles.octaves, settings.octaves);
+
+	Stats stats = {};
+	const std::size_t quarterIndices = GRID_SIZE * GRID_SIZE / 4 * 6;
+	for (const Node& node : selection)
+	{
+		shader.setUniform(handles.node, glm::vec4(node.corner.x, node.corner.y, node.size, GRID_SIZE));
+		shader.setUniform(handles.morph, glm::vec4(ranges[node.level] * MORPH_START, ranges[node.level], 0, 0));
+		if (node.quarter < 0)
+			patch->draw();
+		else
+			patch->draw(node.quarter * quarterIndices, quarterIndices);
+		stats.nodes++;
+		stats.triangles += (node.quarter < 0 ? 4 : 1) * quarterIndices / 3;
+		stats.levelNodes[node.level]++;
+	}
+	return stats;
+}
+
+/**
+ * How far from the camera the coarsest level reaches.
+ */
+float ProceduralTerrain::getViewDistance() const
+{
+	return ranges[LEVEL_COUNT - 1];
+}
+
+std::size_t ProceduralTerrain::getGpuSize() const
+{
+	return patch->getGpuSize();
+}
+
+/**
+ * Adds the node at corner, or the parts of it its children do not cover,
+ * to the selection. Returns false when the node is out of range of its
+ * level, so its parent has to draw that area instead. Nodes outside
+ * frustum count as handled but add nothing.
+ */
+bool ProceduralTerrain::select(const glm::vec2& corner, int level, const glm::vec3& cameraPosition,
+		const Frustum* frustum, float maxHeight)
+{
+	float size = leafSize * (1 << level);
+	float nodeDistance = distance(cameraPosition, corner, size);
+	if (nodeDistance > ranges[level])
+		return false;
+	if (frustum && !frustum->intersects({ corner.x, -maxHeight, corner.y, size, 2 * maxHeight, size }))
+		return true;
+
+	if (level == 0 || nodeDistance > ranges[level - 1])
+	{
+		selection.push_back({ corner, size, level, -1 });
+		return true;
+	}
+
+	float half = size / 2;
+	for (int quarter = 0; quarter < 4; quarter++)
+	{
+		glm::vec2 child = corner + half * glm::vec2(quarter & 1, quarter >> 1);
+		if (!select(child, level - 1, cameraPosition, frustum, maxHeight))
+			selection.push_back({ corner, size, level, quarter });
+	}
+	return true;
+}
+
+/**
+ * The largest height vertex.glsl can displace a vertex by, up or down.
+ */
+float ProceduralTerrain::getMaxHeight() const
+{
+	float height = 0;
+	float amplitude = settings.height;
+	for (int i = 0; i < settings.octaves; i++)
+	{
+		height += 0.5f * amplitude;
+		amplitude *= settings.persistence;
+	}
+	return height;
+}
+
+/**
+ * The distance from point to the node's square on the y = 0 plane,
+ * which vertex.glsl also measures morphing against.
+ */
+float ProceduralTerrain::distance(const glm::vec3& point, const glm::vec2& corner, float size)
+{
+	glm::vec2 ground(point.x, point.z);
+	glm::vec2 nearest = glm::clamp(ground, corner, corner + size);
+	return std::sqrt(glm::dot(ground - nearest, ground - nearest) + point.y * point.y);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "Shader.h"
+#include "Frustum.h"
+
+/**
+ * Terrain without a heightfield, following Strugar's "Continuous
+ * Distance-Dependent Level of Detail" (CDLOD). One small grid patch is
+ * drawn once per node of a quadtree laid over the xz plane around the
+ * camera. vertex.glsl displaces every vertex by fBm of the same perlin
+ * noise that textures the terrain. Node sizes double with each level,
+ * so the nodes form rings of coarser detail further from the camera.
+ * Towards the end of its level's range a node morphs into its parent's
+ * grid, so switching level never pops.
+ *
+ * The patch is the only GPU memory used, however far the camera flies.
+ */
+class ProceduralTerrain
+{
+	public:
+		static const int GRID_SIZE = 32;	// Quads per side of the patch.
+		static const int LEVEL_COUNT = 5;
+
+		struct Settings
+		{
+			float height;			// Amplitude of the first octave.
+			float frequency;		// Of the first octave, per world unit.
+			float persistence;		// Amplitude ratio between octaves.
+			int octaves;
+			float textureScale;		// World to texture coordinates for fragment.glsl.
+		};
+
+		struct Stats
+		{
+			unsigned int nodes;
+			std::size_t triangles;
+			unsigned int levelNodes[LEVEL_COUNT];
+		};
+
+		ProceduralTerrain(float leafSize = 2.0f);
+		~ProceduralTerrain();
+		Stats draw(const Shader& shader, const glm::vec3& cameraPosition, const Frustum* frustum);
+		float getViewDistance() const;
+		std::size_t getGpuSize() const;
+		Settings settings;
+
+	private:
+		// A node to draw. quarter is -1 for the whole patch, otherwise the
+		// quadrant drawn at this node's level because its child was out of
+		// range of the finer level.
+		struct Node
+		{
+			glm::vec2 corner;
+			float size;
+			int level;
+			int quarter;
+		};
+
+		// draw()'s uniform handles in one program.
+		struct Uniforms
+		{
+			Uniform<glm::vec4> shape;
+			Uniform<int> octaves;
+			Uniform<glm::vec4> node;
+			Uniform<glm::vec4> morph;
+		};
+
+		std::unique_ptr<Mesh> patch;
+		float leafSize;				// Of the nodes at level 0.
+		float ranges[LEVEL_COUNT];	// Level l is drawn up to ranges[l] from the camera.
+		std::vector<Node> selection;
+		// Resolved the first time each program draws. ShaderCache keeps its
+		// programs until it is destroyed, so the pointer names the program.
+		std::unordered_map<const Shader*, Uniforms> uniforms;
+
+		bool select(const glm::vec2& corner, int level, const glm::vec3& cameraPosition,
+				const Frustum* frustum, float maxHeight);
+		float getMaxHeight() const;
+		static float distance(const glm::vec3& point, const glm::vec2& corner, float size);
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+/**
+ * How an object's fragments are combined with the framebuffer. The
+ * Renderer draws every opaque object before any blended one.
+ */
+struct RenderState
+{
+	enum Blend
+	{
+		OPAQUE = 0,
+		// Blended over what is behind by the fragment's alpha. Drawn back
+		// to front without writing depth.
+		ALPHA
+	};
+
+	enum Cull
+	{
+		CULL_NONE = 0,
+		// Only for closed meshes wound counter clockwise, whose back faces
+		// are always hidden.
+		CULL_BACK
+	};
+
+	Blend blend = OPAQUE;
+	Cull cull = CULL_NONE;
+};
@@ -9,52 +9,63 @@
 #include <iostream>
 #include <filesystem>
 #include <cstdlib>
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <chrono>
+#include <noise/Noise.h>
 
 #include "Renderer.h"
-
-Renderer::Renderer(int seed) :
-	logs(3), demoModels(4),
-	showCursor(false), rotate(0), scale(1), camera(glm::vec3(0,5,12)),
+#include "GLDebug.h"
+
+Renderer::Renderer(int seed, PermSource::Type permSourceType, Mesh::VertexFormat vertexFormat) :
+	specializeOctaves(false), programSwitches(0), instancing(true), drawCalls(0),
+	culling(true), culledModels(0), culledMeshes(0), matrixUpdates(0),
+	depthSorting(true), overdraw(), samplesQuery(0), samplesPending(false), samplesSorted(false),
+	chunkedTerrain(true), terrainPixelError(2), terrainStats(), terrainMode(MESH_TERRAIN), proceduralStats(),
+	frameNumber(0),
+	resources(std::thread::hardware_concurrency() / 2, threadPool, vertexFormat), logs(3), demoModels(4),
+	showCursor(false), startupSeconds(0), loadedSeconds(0), camera(glm::vec3(0,5,12)),
 	firstMouse(true), lastX(width / 2.0f), lastY(height / 2.0f),
-	shiftPressed(false), deltaTime(0.0f), lastFrame(0.0f)
+	shiftPressed(false), deltaTime(0.0f), lastFrame(0.0f), lightPos(-5.0, 25.0, 20.0),
+	noise(seed, PermSource::getPermutation(permSourceType))
 {
 	initWindow();
 	initImGui();
-	shader = std::make_unique<Shader>("shaders/vertex.glsl", "shaders/fragment.glsl");
-	shader->link();
+	glGenQueries(1, &samplesQuery);
+	permSource = std::make_unique<PermSource>(permSourceType, noise);
+	shaders = std::make_unique<ShaderCache>("shaders/vertex.glsl", "shaders/fragment.glsl",
+			std::vector<std::string>{ permSource->getDefine() }, [this](Shader& shader) {
+		shader.bindUniformBlock("FrameBlock", FrameBlock::BINDING);
+		// INSTANCED variants read their model settings from attributes.
+		if (shader.hasUniformBlock("ModelBlock"))
+			shader.bindUniformBlock("ModelBlock", ModelBlock::BINDING);
+
+		// The CPU noise library and the shader share one permutation table.
+		permSource->setUniforms(shader);
+		if (shader.hasUniform("waveData"))
+			shader.setUniform1i("waveData", 0);
+		if (shader.hasUniform("turbulenceVolume"))
+			shader.setUniform1i("turbulenceVolume", 1);
+	}, "shaderCache");
+	frameUniforms = std::make_unique<UniformRing>(sizeof(FrameBlock));
+	frameUniforms->allocate();
+	instanceBuffer = std::make_unique<InstanceBuffer>();
+	procedural = std::make_unique<ProceduralTerrain>();
+	streamer = std::make_unique<TerrainStreamer>(noise, threadPool, 16 * 1024 * 1024);
 	loadModels();	
-	setupModels();
+	modelUniforms = std::make_unique<UniformRing>(sizeof(ModelBlock), resources.getRequestCount());
 	
 	perspective = glm::perspective(glm::radians(45.0f), float(width)/height, 0.1f, 100.0f);
-	shader->use();
-	shader->setUniformMatrix4fv("perspective", perspective);
-	shader->setUniformMatrix4fv("view", camera.getViewMatrix());
-
-	glm::vec3 lightPos = glm::vec3(-5.0, 25.0, 20.0);
-	shader->setUniform3fv("lightPos", lightPos);
-
-	int perm[256];
-	for (unsigned int i = 0; i < 256; i++)
-		perm[i] = i;
-	shuffle(perm, seed);
-	shader->setUniform1iv("perm", 256, perm);
-	shader->setUniform1iv("perm[256]", 256, perm);
-
-	glUseProgram(0);	// unbind shader
 }
 
-Renderer::~Renderer() {}
-
-void Renderer::shuffle(int perm[256], int seed)
+/*
+ * The streamer's workers use noise, which is destroyed first.
+ */
+Renderer::~Renderer()
 {
-	std::srand(seed);
-	for(unsigned int i = 0; i < 256; i++)
-	{
-		int rand = std::rand() % 256;
-		int tmp = perm[i];
-		perm[i] = perm[rand];
-		perm[rand] = tmp;
-	}
+	streamer.reset();
+	glDeleteQueries(1, &samplesQuery);
 }
 
 void Renderer::initWindow()
@@ -64,6 +75,9 @@ void Renderer::initWindow()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifndef NDEBUG
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
 
 	window = glfwCreateWindow(width, height, "OpenGL Example", nullptr, nullptr);
 	if (!window)
@@ -79,6 +93,7 @@ void Renderer::initWindow()
 		std::cerr << "Failed to initialize GLAD" << std::endl;
 		exit(-1);
 	}
+	GLDebug::init((GLADloadproc)glfwGetProcAddress);
 
 	glViewport(0, 0, width, height);
 
@@ -99,9 +114,9 @@ void Renderer::initWindow()
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
+	// Blending and face culling are switched per model by drawModels().
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
+	glCullFace(GL_BACK);
 }
 
 void Renderer::initImGui()
@@ -121,6 +136,10 @@ void Renderer::initImGui()
     ImGui_ImplOpenGL3_Init("#version 330");
 }
 
+/*
+ * Requests every model. They are loaded in the background and show up
+ * as update() finishes them.
+ */
 void Renderer::loadModels()
 {
 	namespace fs = std::filesystem;
@@ -135,95 +154,118 @@ void Renderer::loadModels()
 	const std::string teapotPath = dir + "teapot.obj";
 	const std::string bunnyPath = dir + "bunny.obj";
 
-	for (auto& log : logs)
-	{
-		loadModel(logPath, log);
-	}
-
-	loadModel(waterPath, water);
-	loadModel(terrainPath, terrain);
-
-	loadModel(cubePath, demoModels[0]);
-	loadModel(spherePath, demoModels[1]);
-	loadModel(teapotPath, demoModels[2]);
-	loadModel(bunnyPath, demoModels[3]);
+	loadModel(waterPath, water, [](Model& water) {
+		Model::FragmentSettings& fs = water.getFragmentSettings();
+		fs.noiseEffect = Model::NoiseType::WATER;
+		fs.phaseSpeed = 1.4;
+		fs.minFrequency = 50;
+		fs.maxFrequency = 200;
+		fs.waveCenters = 20;
+		// fragment.glsl gives water an alpha of 0.5. The water is a closed
+		// box, so culling keeps its bottom from being blended in too.
+		water.getRenderState().blend = RenderState::ALPHA;
+		water.getRenderState().cull = RenderState::CULL_BACK;
+		water.getTransform().translate(glm::vec3(0,-2.77,0));
+		water.getTransform().scale(20);
+	});
 
+	loadModel(terrainPath, terrain, [this, terrainPath](Model& terrain) {
+		Model::FragmentSettings& fs = terrain.getFragmentSettings();
+		fs.noiseEffect = Model::NoiseType::GRASS;
+		fs.persistence = 7/16.0f;
+		fs.octaveCount = 4;
+		fs.octaveStart = 1;
+		terrain.getTransform().scale(10);
+		buildTerrainChunks(terrainPath);
+	});
 
-	models.push_back(water);
-	models.push_back(terrain);
-	for (auto& log : logs)
+	const float logScales[] = { 0.5, 0.40, 0.35 };
+	const glm::vec3 logPositions[] = { glm::vec3(-7,1,0), glm::vec3(-3,1.5,15), glm::vec3(14,2.15,5) };
+	for (unsigned int i = 0; i < logs.size(); i++)
 	{
-		models.push_back(log);
+		loadModel(logPath, logs[i], [scale = logScales[i], position = logPositions[i]](Model& log) {
+			Model::FragmentSettings& fs = log.getFragmentSettings();
+			fs.noiseEffect = Model::NoiseType::WOOD;
+			fs.persistence = 2/16.0f;
+			fs.ringFrequency = 80;
+			fs.octaveCount = 3;
+			fs.octaveStart = 0;
+			log.getRenderState().cull = RenderState::CULL_BACK;
+			log.getTransform().translate(position);
+			log.getTransform().scale(scale);
+		});
 	}
 
-	for (auto& model : demoModels)
+	const std::string demoPaths[] = { cubePath, spherePath, teapotPath, bunnyPath };
+	const glm::vec3 demoPositions[] = { glm::vec3(-4, 5, 0), glm::vec3(-5, 12, 0), glm::vec3(0, 30, 0),
+		glm::vec3(5, 15, -0.1) };
+	// The teapot and the bunny have holes, so their back faces show.
+	const bool demoClosed[] = { true, true, false, false };
+	for (unsigned int i = 0; i < demoModels.size(); i++)
 	{
-		models.push_back(model);
+		loadModel(demoPaths[i], demoModels[i],
+				[this, position = demoPositions[i], closed = demoClosed[i]](Model& model) {
+			// Every demo model shows the settings of the first one.
+			Model::FragmentSettings& fs = model.getFragmentSettings();
+			if (demoModels[0])
+			{
+				fs = demoModels[0]->getFragmentSettings();
+			}
+			else
+			{
+				fs.noiseEffect = Model::NoiseType::BLACK_WHITE;
+				fs.persistence = 1;
+				fs.ringFrequency = 80;
+				fs.octaveCount = 1;
+				fs.octaveStart = 0;
+				fs.phaseSpeed = 1.4;
+				fs.minFrequency = 50;
+				fs.maxFrequency = 200;
+				fs.waveCenters = 20;
+			}
+			if (fs.noiseEffect == Model::NoiseType::WATER)
+				model.getRenderState().blend = RenderState::ALPHA;
+			if (closed)
+				model.getRenderState().cull = RenderState::CULL_BACK;
+			model.getTransform().translate(position);
+		});
 	}
 }
 
-void Renderer::loadModel(const std::string path, std::shared_ptr<Model>& model)
+/*
+ * Splits the terrain into chunks with LODs on the thread pool. run()
+ * takes and uploads them once they are built. The file is in the mesh
+ * cache by now, so reading it again only maps it.
+ */
+void Renderer::buildTerrainChunks(const std::string& path)
 {
-	std::cout << "Loading " << path << "..." << std::flush;
-	model = std::make_shared<Model>(path);
-	std::cout << "Done!\n"; 
+	auto build = std::make_shared<std::packaged_task<std::unique_ptr<TerrainChunks>()>>([path]() {
+		MeshSource source(path, MeshGroup::DEFAULT_IMPORT_FLAGS);
+		if (source.getMeshCount() == 0)
+			return std::unique_ptr<TerrainChunks>();
+		return std::make_unique<TerrainChunks>(source.getMeshData(0));
+	});
+	terrainBuild = build->get_future();
+	threadPool.submit([build]() { (*build)(); });
 }
 
-void Renderer::setupModels()
+/*
+ * Requests path from the ResourceManager. Once it is loaded, model is
+ * made from it in the scene and set up. A file that failed to import
+ * leaves model null.
+ */
+void Renderer::loadModel(const std::string path, std::unique_ptr<Model>& model, std::function<void(Model&)> setup)
 {
-	// Water
-	water->fragmentSettings.noiseEffect = Model::NoiseType::WATER;
-	water->fragmentSettings.phaseSpeed = 1.4;
-	water->fragmentSettings.minFrequency = 50;
-	water->fragmentSettings.maxFrequency = 200;
-	water->fragmentSettings.waveCenters = 20;
-	water->scale(20);
-	water->translate(glm::vec3(0,-2.77,0));
-
-	// Terrain
-	terrain->fragmentSettings.noiseEffect = Model::NoiseType::GRASS;
-	terrain->fragmentSettings.persistence = 7/16.0f;
-	terrain->fragmentSettings.octaveCount = 4;
-	terrain->fragmentSettings.octaveStart = 1;
-	terrain->scale(10);
-
-	// Logs
-	for(auto& log : logs)
-	{
-		log->fragmentSettings.noiseEffect = Model::NoiseType::WOOD;
-		log->fragmentSettings.persistence = 2/16.0f;
-		log->fragmentSettings.ringFrequency = 80;
-		log->fragmentSettings.octaveCount = 3;
-		log->fragmentSettings.octaveStart = 0;
-	}
-
-	logs[0]->scale(0.5);
-	logs[0]->translate(glm::vec3(-7,1,0));
-	logs[1]->scale(0.40);
-	logs[1]->translate(glm::vec3(-3,1.5,15));
-	logs[2]->scale(0.35);
-	logs[2]->translate(glm::vec3(14,2.15,5));
-
-	// Demo models
-	for(auto& model : demoModels)
-	{
-		model->fragmentSettings.noiseEffect = Model::NoiseType::BLACK_WHITE;
-		model->fragmentSettings.persistence = 1;
-		model->fragmentSettings.ringFrequency = 80;
-		model->fragmentSettings.octaveCount = 1;
-		model->fragmentSettings.octaveStart = 0;
-		model->fragmentSettings.phaseSpeed = 1.4;
-		model->fragmentSettings.minFrequency = 50;
-		model->fragmentSettings.maxFrequency = 200;
-		model->fragmentSettings.waveCenters = 20;
-	}
-		demoModels[0]->translate(glm::vec3(-4, 5, 0));
-		demoModels[1]->translate(glm::vec3(-5, 12, 0));
-		demoModels[2]->translate(glm::vec3(0, 30, 0));
-		demoModels[3]->translate(glm::vec3(5, 15, -0.1));
-
-	for(auto& model : models)
-		model->update();
+	resources.requestMeshGroup(path, [this, path, &model, setup](std::shared_ptr<const MeshGroup> meshGroup) {
+		if (meshGroup->getMeshCount() == 0)
+		{
+			std::cerr << "Failed to load " << path << ", skipping its model" << std::endl;
+			return;
+		}
+		model = std::make_unique<Model>(scene, meshGroup);
+		setup(*model);
+		std::cout << "Loaded " << path << " after " << glfwGetTime() * 1000 << " ms\n";
+	});
 }
 
 void Renderer::run()
@@ -238,37 +280,312 @@ void Renderer::run()
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		processWindowInput();
-
-		shader->use();
-		shader->setUniformMatrix4fv("view", camera.getViewMatrix());
-		shader->setUniformMatrix4fv("perspective", perspective);
-		shader->setUniform1f("time", currentFrame);
-		shader->setUniform3fv("toCamera", camera.getPosition());
-
-		for (auto& model : models)
+		camera.update(deltaTime);
+		resources.update(uploadBudget);
+		if (loadedSeconds == 0 && resources.getPendingCount() == 0)
+		{
+			loadedSeconds = glfwGetTime();
+			std::cout << "Loaded " << scene.size() << " models after " << loadedSeconds * 1000 << " ms" << std::endl;
+		}
+		if (terrainBuild.valid() && terrainBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			terrainChunks = terrainBuild.get();
+			if (terrainChunks)
+				terrainChunks->upload(resources.getVertexFormat());
+		}
+		if (terrainMode == STREAMED_TERRAIN)
 		{
-			model->rotate(rotate);
-			model->scale(scale);
-			model->update();
-			model->draw(*shader);
+			streamer->setSettings(procedural->settings);
+			streamer->update(camera.getPosition(), camera.getVelocity(), camera.getFront(), streamBudget);
 		}
 
+		permSource->bind();
+		frameUniforms->beginFrame();
+		modelUniforms->beginFrame();
+
+		FrameBlock frame = {};
+		frame.view = camera.getViewMatrix();
+		frame.perspective = perspective;
+		frame.toCamera = camera.getPosition();
+		frame.time = currentFrame;
+		frame.lightPos = lightPos;
+		frameUniforms->write(0, &frame, ++frameNumber);
+		frameUniforms->bind(0, FrameBlock::BINDING);
+
+		drawModels();
+
+		frameUniforms->endFrame();
+		modelUniforms->endFrame();
 		glUseProgram(0);
 
-		rotate = glm::vec3(0.0f);
-		scale = 1;
-		
 		showGui();
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+
+		if (startupSeconds == 0)
+			reportStartup();
 	}
 
+	GLDebug::printSummary();
+
     // Cleanup
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 }
 
+/*
+ * Tests every model's world box against the view frustum and picks a
+ * shader variant for each visible model, then draws in two passes. Opaque
+ * models go first with blending off, grouped by program so each program
+ * is bound once, or front to back with depthSorting. Either way, models
+ * of one program and MeshGroup become one instanced draw. Blended models
+ * follow back to front without writing depth, one by one.
+ */
+void Renderer::drawModels()
+{
+	// index is the object's place in the scene's arrays. distance is
+	// squared, to the nearest point of an opaque model's world box, which
+	// suits large occluders like the terrain, and to the centre of a
+	// blended one's. groupDistance is the nearest distance in the draw's
+	// instanced group, or its own distance when it is drawn by itself.
+	struct Draw
+	{
+		Shader* shader;
+		std::size_t index;
+		Model* model;
+		bool instanced;
+		bool blended;
+		RenderState::Cull cull;
+		float distance;
+		float groupDistance;
+	};
+	typedef std::tuple<const Shader*, const MeshGroup*, RenderState::Cull> GroupKey;
+
+	// Read last frame's samples if the GPU is done with them, and only
+	// start a new query then.
+	int viewportWidth = 0, viewportHeight = 0;
+	glfwGetFramebufferSize(window, &viewportWidth, &viewportHeight);
+	if (samplesPending)
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(samplesQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint samples = 0;
+			glGetQueryObjectuiv(samplesQuery, GL_QUERY_RESULT, &samples);
+			overdraw[samplesSorted] = float(samples) / std::max(viewportWidth * viewportHeight, 1);
+			samplesPending = false;
+		}
+	}
+	bool countSamples = !samplesPending;
+	if (countSamples)
+	{
+		glBeginQuery(GL_SAMPLES_PASSED, samplesQuery);
+		samplesSorted = depthSorting;
+	}
+
+	matrixUpdates = scene.update();
+	Frustum frustum(perspective * camera.getViewMatrix());
+	if (culling)
+		culledModels = scene.size() - scene.cull(frustum, visible);
+	else
+	{
+		visible.assign(scene.size(), 1);
+		culledModels = 0;
+	}
+
+	bool drawChunks = chunkedTerrain && terrainChunks && terrainChunks->isUploaded();
+	const std::vector<Model*>& sceneModels = scene.getModels();
+	const std::vector<const MeshGroup*>& meshGroups = scene.getMeshGroups();
+	const std::vector<RenderState>& renderStates = scene.getRenderStates();
+	const BoxList& worldBoxes = scene.getWorldBoxes();
+	glm::vec3 eye = camera.getPosition();
+	std::vector<Draw> draws;
+	for (std::size_t i = 0; i < scene.size(); i++)
+	{
+		Model* model = sceneModels[i];
+		if (!visible[i] || (terrainMode != MESH_TERRAIN && model == terrain.get()))
+			continue;
+		model->updateWaves(noise);
+		model->updateTurbulence(noise, threadPool);
+		bool blended = renderStates[i].blend != RenderState::OPAQUE;
+		bool instanced = instancing && !blended && model->canDrawInstanced() &&
+			!(drawChunks && model == terrain.get());
+		glm::vec3 min(worldBoxes.minX[i], worldBoxes.minY[i], worldBoxes.minZ[i]);
+		glm::vec3 max(worldBoxes.maxX[i], worldBoxes.maxY[i], worldBoxes.maxZ[i]);
+		glm::vec3 offset = (blended ? (min + max) * 0.5f : glm::clamp(eye, min, max)) - eye;
+		float distance = glm::dot(offset, offset);
+		draws.push_back({ &shaders->get(model->getShaderDefines(specializeOctaves, instanced)),
+				i, model, instanced, blended, renderStates[i].cull, distance, distance });
+	}
+
+	// An instanced group is one draw call, so front to back it moves as a
+	// whole, placed by its nearest member, and keeps its members together.
+	if (depthSorting)
+	{
+		std::map<GroupKey, float> nearest;
+		for (const Draw& draw : draws)
+		{
+			if (!draw.instanced)
+				continue;
+			auto inserted = nearest.insert({ GroupKey(draw.shader, meshGroups[draw.index], draw.cull), draw.distance });
+			if (!inserted.second)
+				inserted.first->second = std::min(inserted.first->second, draw.distance);
+		}
+		for (Draw& draw : draws)
+		{
+			if (draw.instanced)
+				draw.groupDistance = nearest[GroupKey(draw.shader, meshGroups[draw.index], draw.cull)];
+		}
+	}
+	std::stable_sort(draws.begin(), draws.end(), [this, &meshGroups](const Draw& a, const Draw& b) {
+		if (a.blended != b.blended)
+			return b.blended;
+		if (a.blended)
+			return a.distance > b.distance;
+		if (depthSorting && a.groupDistance != b.groupDistance)
+			return a.groupDistance < b.groupDistance;
+		if (a.shader->getId() != b.shader->getId())
+			return a.shader->getId() < b.shader->getId();
+		if (!a.instanced)
+			return false;
+		if (meshGroups[a.index] != meshGroups[b.index])
+			return meshGroups[a.index] < meshGroups[b.index];
+		if (a.cull != b.cull)
+			return a.cull < b.cull;
+		return depthSorting && a.distance < b.distance;
+	});
+
+	// Every instanced program draws only instanced models, so a run of
+	// equal program, MeshGroup and culling is one instanced draw.
+	const std::vector<Transform>& transforms = scene.getTransforms();
+	const std::vector<FragmentSettings>& settings = scene.getSettings();
+	std::vector<InstanceData> instances;
+	for (const Draw& draw : draws)
+	{
+		if (draw.instanced)
+			instances.push_back(Model::getInstanceData(transforms[draw.index].getMatrix(), settings[draw.index]));
+	}
+	if (!instances.empty())
+		instanceBuffer->setData(instances.data(), instances.size());
+
+	programSwitches = 0;
+	drawCalls = 0;
+	culledMeshes = 0;
+	terrainStats = TerrainChunks::Stats();
+	glDisable(GL_BLEND);
+	glDisable(GL_CULL_FACE);
+
+	// The procedural and streamed terrains take the terrain Model's
+	// fragment settings. They are opaque and right below the camera, so
+	// they go first.
+	proceduralStats = ProceduralTerrain::Stats();
+	if (terrainMode != MESH_TERRAIN && terrain)
+	{
+		std::vector<std::string> defines = terrain->getShaderDefines(specializeOctaves);
+		defines.push_back(terrainMode == PROCEDURAL_TERRAIN ? "PROCEDURAL_TERRAIN" : "STREAMED_TERRAIN");
+		Shader& shader = shaders->get(defines);
+		shader.use();
+		programSwitches++;
+		terrain->bind(*modelUniforms);
+		if (terrainMode == PROCEDURAL_TERRAIN)
+		{
+			proceduralStats = procedural->draw(shader, camera.getPosition(), culling ? &frustum : nullptr);
+			drawCalls += proceduralStats.nodes;
+		}
+		else
+		{
+			streamer->draw(shader, culling ? &frustum : nullptr);
+			drawCalls += streamer->getStats().drawn;
+		}
+	}
+
+	const Shader* current = nullptr;
+	bool blending = false;
+	RenderState::Cull cull = RenderState::CULL_NONE;
+	std::size_t instance = 0;
+	for (std::size_t i = 0; i < draws.size(); )
+	{
+		if (draws[i].shader != current)
+		{
+			current = draws[i].shader;
+			current->use();
+			programSwitches++;
+		}
+		if (draws[i].blended && !blending)
+		{
+			glEnable(GL_BLEND);
+			glDepthMask(GL_FALSE);
+			blending = true;
+		}
+		if (draws[i].cull != cull)
+		{
+			cull = draws[i].cull;
+			if (cull == RenderState::CULL_BACK)
+				glEnable(GL_CULL_FACE);
+			else
+				glDisable(GL_CULL_FACE);
+		}
+		if (!draws[i].instanced && drawChunks && draws[i].model == terrain.get())
+		{
+			// An error of e at distance d covers e * pixelScale / d pixels.
+			float pixelScale = viewportHeight * perspective[1][1] / 2;
+			terrain->bind(*modelUniforms);
+			terrainStats = terrainChunks->draw(culling ? &frustum : nullptr, terrain->getModelMatrix(),
+					camera.getPosition(), pixelScale, terrainPixelError);
+			drawCalls += terrainStats.visibleChunks;
+			i++;
+			continue;
+		}
+		if (!draws[i].instanced)
+		{
+			culledMeshes += draws[i].model->draw(*modelUniforms, culling ? &frustum : nullptr);
+			drawCalls++;
+			i++;
+			continue;
+		}
+
+		const MeshGroup* meshGroup = meshGroups[draws[i].index];
+		std::size_t count = 1;
+		while (i + count < draws.size() && draws[i + count].shader == current &&
+				meshGroups[draws[i + count].index] == meshGroup && draws[i + count].cull == cull)
+			count++;
+		meshGroup->drawInstanced(instanceBuffer->getId(), instance, count);
+		drawCalls++;
+		instance += count;
+		i += count;
+	}
+
+	// glClear() only clears depth while writing it is on.
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	glDisable(GL_CULL_FACE);
+	if (countSamples)
+	{
+		glEndQuery(GL_SAMPLES_PASSED);
+		samplesPending = true;
+	}
+}
+
+/*
+ * Prints how long it took from glfwInit() until the first frame was
+ * shown and how the shader programs it needed were built. A warm start
+ * loaded every program from the binary cache.
+ */
+void Renderer::reportStartup()
+{
+	glFinish();
+	startupSeconds = glfwGetTime();
+	const ShaderCache::Stats& stats = shaders->getStats();
+	std::cout << (stats.compiled == 0 ? "Warm" : "Cold") << " startup: first frame after "
+		<< startupSeconds * 1000 << " ms. Shaders took " << stats.seconds * 1000 << " ms, "
+		<< stats.loaded << " loaded from cache, " << stats.compiled << " compiled";
+	if (stats.rejected)
+		std::cout << " (" << stats.rejected << " cached binaries rejected)";
+	std::cout << std::endl;
+}
+
 /*
  * Display the ImGui and handle its events.
  */
@@ -293,26 +610,37 @@ void Renderer::showGui()
 
 	ImGui::Begin("Fragment Shader Settings");
 
-	if (ImGui::CollapsingHeader("Grass/Terrain", ImGuiTreeNodeFlags_None))
+	if (resources.getPendingCount() > 0)
 	{
-		Model::FragmentSettings& fs = terrain->fragmentSettings;
+		unsigned int requested = resources.getRequestCount();
+		unsigned int loaded = requested - resources.getPendingCount();
+		std::string progress = "Loading models " + std::to_string(loaded) + "/" + std::to_string(requested);
+		ImGui::ProgressBar(float(loaded) / requested, ImVec2(-1, 0), progress.c_str());
+	}
+
+	if (terrain && ImGui::CollapsingHeader("Grass/Terrain", ImGuiTreeNodeFlags_None))
+	{
+		Model::FragmentSettings& fs = terrain->getFragmentSettings();
 		ImGui::SliderFloat("Persistence###grp", &fs.persistence, 0.1, 1.0);
 		ImGui::SameLine(); HelpMarker("The ith amplitude is persistence^i.");
 		ImGui::SliderInt("Octaves###gro", &fs.octaveCount, 1, 16);
 		ImGui::SameLine(); HelpMarker("The more octaves are added the smoother the noise will be.");
 		ImGui::SliderInt("Octave Start###gros", &fs.octaveStart, 0, fs.octaveCount-1);
+		ImGui::Checkbox("Baked###grb", &fs.bakedTurbulence);
+		ImGui::SameLine(); HelpMarker("Sample a precomputed 3D texture instead of evaluating every octave.");
 	}
 
 	for (unsigned int i = 0; i < logs.size(); i++)
 	{
 		std::string header = "Wood " + std::to_string(i+1);
-		if (ImGui::CollapsingHeader(header.c_str(), ImGuiTreeNodeFlags_None))
+		if (logs[i] && ImGui::CollapsingHeader(header.c_str(), ImGuiTreeNodeFlags_None))
 		{
-			Model::FragmentSettings& fs = logs[i]->fragmentSettings;
+			Model::FragmentSettings& fs = logs[i]->getFragmentSettings();
 			std::string persistence = "Persistence###wp " + std::to_string(i);
 			std::string ringFreq = "Ring Frequency###wf " + std::to_string(i);
 			std::string octaves = "Octaves###woc" + std::to_string(i);
 			std::string octavesStart = "Octaves###wocs" + std::to_string(i);
+			std::string baked = "Baked###wb" + std::to_string(i);
 
 
 			ImGui::SliderFloat(persistence.c_str(), &fs.persistence, 0.1, 1.0);
@@ -322,19 +650,21 @@ void Renderer::showGui()
 			ImGui::SliderInt(octaves.c_str(), &fs.octaveCount, 1, 16);
 			ImGui::SameLine(); HelpMarker("The more octaves are added the smoother the noise will be.");
 			ImGui::SliderInt(octavesStart.c_str(), &fs.octaveStart, 0, fs.octaveCount-1);
+			ImGui::Checkbox(baked.c_str(), &fs.bakedTurbulence);
+			ImGui::SameLine(); HelpMarker("Sample a precomputed 3D texture instead of evaluating every octave.");
 		}
 	}
 
-	if (ImGui::CollapsingHeader("Waves", ImGuiTreeNodeFlags_None))
+	if (water && ImGui::CollapsingHeader("Waves", ImGuiTreeNodeFlags_None))
 	{
-		Model::FragmentSettings& fs = water->fragmentSettings;
-		ImGui::SliderInt("Wave Centers", &fs.waveCenters, 0, 20);
+		Model::FragmentSettings& fs = water->getFragmentSettings();
+		ImGui::SliderInt("Wave Centers", &fs.waveCenters, 0, 256);
 		ImGui::SliderFloat("Wave Speed", &fs.phaseSpeed, 0, 3.0);
 		ImGui::SliderFloat("Min Frequency", &fs.minFrequency, 1, fs.maxFrequency);
 		ImGui::SliderFloat("Max Frequency", &fs.maxFrequency, 0.01, 500);
 	}
 
-	if (ImGui::CollapsingHeader("Demo Models", ImGuiTreeNodeFlags_None))
+	if (demoModels[0] && ImGui::CollapsingHeader("Demo Models", ImGuiTreeNodeFlags_None))
 	{
 		const char* noiseNames[Model::NoiseType::COUNT] = {
 			"Grass/Terrain",
@@ -342,7 +672,7 @@ void Renderer::showGui()
 			"Water",
 			"Black/White",
 			"None"};
-		Model::FragmentSettings& fs = demoModels[0]->fragmentSettings;
+		Model::FragmentSettings& fs = demoModels[0]->getFragmentSettings();
 		//int noiseEffect = fs.noiseEffect;
 		ImGui::SliderInt("Texture", reinterpret_cast<int*>(&fs.noiseEffect), 0, Model::NoiseType::COUNT - 1, noiseNames[fs.noiseEffect]);
 
@@ -353,28 +683,110 @@ void Renderer::showGui()
 		ImGui::SameLine(); HelpMarker("The more octaves are added the smoother the noise will be.");
 
 		ImGui::SliderInt("Octave Start###demoos", &fs.octaveStart, 0, fs.octaveCount-1);
+		ImGui::Checkbox("Baked###demob", &fs.bakedTurbulence);
+		ImGui::SameLine(); HelpMarker("Sample a precomputed 3D texture instead of evaluating every octave.");
 
 		ImGui::SliderFloat("Ring Frequency###demorf", &fs.ringFrequency, 0.1, 100.0);
 
-		ImGui::SliderInt("Wave Centers###demowc", &fs.waveCenters, 0, 20);
+		ImGui::SliderInt("Wave Centers###demowc", &fs.waveCenters, 0, 256);
 		ImGui::SliderFloat("Wave Speed###demows", &fs.phaseSpeed, 0, 3.0);
 		ImGui::SliderFloat("Min Frequency###demowmax", &fs.minFrequency, 1, fs.maxFrequency);
 		ImGui::SliderFloat("Max Frequency###demomin", &fs.maxFrequency, 0.01, 500);
 
 		for(auto& model : demoModels)
 		{
-			Model::FragmentSettings& demoFs = model->fragmentSettings;
+			if (!model)
+				continue;
+			Model::FragmentSettings& demoFs = model->getFragmentSettings();
 			demoFs.noiseEffect = fs.noiseEffect;
 			demoFs.persistence = fs.persistence;
 			demoFs.ringFrequency = fs.ringFrequency;
 			demoFs.octaveCount = fs.octaveCount;
 			demoFs.octaveStart = fs.octaveStart;
+			demoFs.bakedTurbulence = fs.bakedTurbulence;
 			demoFs.waveCenters = fs.waveCenters;
 			demoFs.phaseSpeed = fs.phaseSpeed;
 			demoFs.minFrequency = fs.minFrequency;
 			demoFs.maxFrequency = fs.maxFrequency;
+			model->getRenderState().blend = fs.noiseEffect == Model::NoiseType::WATER ?
+				RenderState::ALPHA : RenderState::OPAQUE;
+		}
+	}
+	ImGui::Checkbox("Compile octave counts into shaders", &specializeOctaves);
+	ImGui::SameLine(); HelpMarker("Builds a shader variant per octave count so the turbulence loop has constant bounds.");
+	ImGui::Text("Shader variants %zu, program switches %u", shaders->size(), programSwitches);
+	ImGui::Checkbox("Instanced drawing", &instancing);
+	ImGui::SameLine(); HelpMarker("Draws models that share a mesh and shader variant with one instanced call. Water and baked turbulence are drawn one by one.");
+	ImGui::Text("Draws %u for %zu models", drawCalls, scene.size());
+	ImGui::Checkbox("Frustum culling", &culling);
+	ImGui::SameLine(); HelpMarker("Skips models whose world space bounding box is outside the view, and meshes of models drawn one by one.");
+	ImGui::Text("Culled %u of %zu models, %u meshes", culledModels, scene.size(), culledMeshes);
+	ImGui::Checkbox("Sort opaque models front to back", &depthSorting);
+	ImGui::SameLine(); HelpMarker("Opaque models are drawn before blended ones either way. Front to back, nearer models fill the depth buffer first, so fragments they hide fail the depth test before they are shaded. Instanced models move as one draw, placed by their nearest instance. Off, they are grouped by program to switch programs less. Blended models always go back to front.");
+	ImGui::Text("Fragments per pixel %.2f sorted, %.2f by program", overdraw[1], overdraw[0]);
+	ImGui::SameLine(); HelpMarker("Samples that passed the depth test while drawing the models, divided by the pixels on screen, for the last frame drawn each way. Toggle the sorting to fill in both.");
+	ImGui::Text("Model matrices recomputed %u", matrixUpdates);
+	ImGui::SameLine(); HelpMarker("Models whose transform changed this frame. The others keep their cached matrix, world box and uniform block.");
+	if (terrainChunks && terrainChunks->isUploaded())
+	{
+		ImGui::Checkbox("Chunked terrain", &chunkedTerrain);
+		ImGui::SameLine(); HelpMarker("Draws the terrain as chunks, each at the coarsest level of detail whose height error stays below the pixel error on screen. Chunks outside the view are skipped when culling is on.");
+		ImGui::SliderFloat("Terrain pixel error", &terrainPixelError, 0.5f, 20.0f, "%.1f px");
+		std::string lods;
+		for (int l = 0; l < terrainChunks->getLodCount(); l++)
+		{
+			lods += (l ? "/" : "") + std::to_string(terrainStats.lodChunks[l]);
+		}
+		ImGui::Text("Terrain chunks %u of %u, %zu triangles, per LOD %s", terrainStats.visibleChunks,
+				terrainStats.chunkCount, terrainStats.triangles, lods.c_str());
+	}
+	ImGui::RadioButton("Mesh terrain", &terrainMode, MESH_TERRAIN); ImGui::SameLine();
+	ImGui::RadioButton("Procedural", &terrainMode, PROCEDURAL_TERRAIN); ImGui::SameLine();
+	ImGui::RadioButton("Streamed", &terrainMode, STREAMED_TERRAIN);
+	ImGui::SameLine(); HelpMarker("Procedural replaces the terrain mesh with one grid patch drawn around the camera at coarser levels further away, displaced in the vertex shader by fBm of the same perlin noise. Nodes morph into the coarser level towards the end of their range.\nStreamed generates chunks of the same fBm with the CPU noise library on worker threads, nearest first to where the camera is heading, and keeps them in a pool with least recently used eviction.");
+	if (terrainMode != MESH_TERRAIN)
+	{
+		ProceduralTerrain::Settings& ts = procedural->settings;
+		ImGui::SliderFloat("Height###pth", &ts.height, 0.0f, 20.0f);
+		ImGui::SliderFloat("Frequency###ptf", &ts.frequency, 0.002f, 0.2f, "%.3f");
+		ImGui::SliderFloat("Persistence###ptp", &ts.persistence, 0.0f, 1.0f);
+		ImGui::SliderInt("Octaves###pto", &ts.octaves, 1, 10);
+	}
+	if (terrainMode == PROCEDURAL_TERRAIN)
+	{
+		std::string levels;
+		for (int l = 0; l < ProceduralTerrain::LEVEL_COUNT; l++)
+		{
+			levels += (l ? "/" : "") + std::to_string(proceduralStats.levelNodes[l]);
 		}
+		ImGui::Text("Terrain nodes %u, %zu triangles, per level %s", proceduralStats.nodes,
+				proceduralStats.triangles, levels.c_str());
+		ImGui::Text("Patch %.1f KB, view distance %.0f", procedural->getGpuSize() / 1024.0f,
+				procedural->getViewDistance());
+	}
+	if (terrainMode == STREAMED_TERRAIN)
+	{
+		int capMb = int(streamer->getMemoryCap() / (1024 * 1024));
+		if (ImGui::SliderInt("Chunk memory###stm", &capMb, 1, 64, "%d MB"))
+			streamer->setMemoryCap(std::size_t(capMb) * 1024 * 1024);
+		const TerrainStreamer::Stats& ss = streamer->getStats();
+		ImGui::Text("Chunks %zu of %zu resident, %u drawn, %zu pending", ss.resident, ss.slots, ss.drawn,
+				ss.pending);
+		ImGui::Text("Uploaded %u this frame, %u evicted, pool %.2f MB", ss.uploaded, ss.evicted,
+				ss.gpuSize / (1024.0f * 1024.0f));
 	}
+	const ShaderCache::Stats& shaderStats = shaders->getStats();
+	ImGui::Text("Shaders: %u cached, %u compiled, %.1f ms. First frame at %.1f ms", shaderStats.loaded,
+			shaderStats.compiled, shaderStats.seconds * 1000, startupSeconds * 1000);
+	if (loadedSeconds > 0)
+		ImGui::Text("All models loaded at %.1f ms", loadedSeconds * 1000);
+	ImGui::Text("Model uniform uploads %u/%zu", modelUniforms->getUploadCount(), scene.size());
+	ImGui::SameLine(); HelpMarker("Models whose ModelBlock had to be uploaded this frame. Unchanged models only rebind their slot.");
+	ImGui::Text("Mesh groups %zu for %zu models, %u shared", resources.getLiveCount(), scene.size(),
+			resources.getShareCount());
+	ImGui::Text("Mesh memory %.2f MB (%s vertices)", resources.getGpuSize() / (1024.0f * 1024.0f),
+			resources.getVertexFormat() == Mesh::COMPACT ? "compact" : "full");
+	ImGui::SameLine(); HelpMarker("Vertex and index buffers of the live mesh groups. Start with --vertices compact for 12 byte vertices and 16 bit indices.");
 	ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 	ImGui::End();
 
@@ -7,34 +7,115 @@
 #include <glm/glm.hpp>
 
 #include <memory>
+#include <functional>
+#include <future>
 
 #include "Model.h"
+#include "Scene.h"
 #include "Shader.h"
+#include "ShaderCache.h"
 #include "Camera.h"
 #include "Texture.h"
+#include "ThreadPool.h"
+#include "UniformRing.h"
+#include "InstanceBuffer.h"
+#include "PermSource.h"
+#include "ResourceManager.h"
+#include "Frustum.h"
+#include "TerrainChunks.h"
+#include "ProceduralTerrain.h"
+#include "TerrainStreamer.h"
+#include <noise/Noise.h>
 
 class Renderer
 {
 	public:
-		Renderer(int seed);
+		Renderer(int seed, PermSource::Type permSourceType, Mesh::VertexFormat vertexFormat = Mesh::FULL);
 		~Renderer();
 		void run();
 
 	private:
 		GLFWwindow* window;
-		std::shared_ptr<Shader> shader;
-		std::shared_ptr<Model> terrain;
-		std::shared_ptr<Model> water;
-		std::vector<std::shared_ptr<Model>> logs;
-		std::vector<std::shared_ptr<Model>> models;
-		std::vector<std::shared_ptr<Model>> demoModels;
+		// One fragment.glsl program per Model::NoiseType, and per octave
+		// count when specializeOctaves is on.
+		std::unique_ptr<ShaderCache> shaders;
+		bool specializeOctaves;
+		unsigned int programSwitches;
+		// Models that share a program and MeshGroup are drawn with one
+		// instanced call per mesh when instancing is on.
+		bool instancing;
+		unsigned int drawCalls;
+		std::unique_ptr<InstanceBuffer> instanceBuffer;
+		// Models, and meshes of non instanced models, outside the view
+		// frustum are skipped when culling is on.
+		bool culling;
+		unsigned int culledModels;
+		unsigned int culledMeshes;
+		// Model matrices recomputed this frame. Models whose Transform did
+		// not change keep their matrix and world box.
+		unsigned int matrixUpdates;
+		std::vector<unsigned char> visible;
+		// Opaque models are drawn first with blending off, then blended
+		// ones back to front. With depthSorting the opaque models go front
+		// to back, so hidden fragments fail the depth test before they are
+		// shaded, instead of being grouped by program. An instanced group
+		// stays one draw, placed by its nearest instance.
+		bool depthSorting;
+		// Samples that passed the depth test while drawing the models, per
+		// pixel, with and without depthSorting. The query is read a frame
+		// or more late so the CPU does not wait for the GPU.
+		float overdraw[2];
+		unsigned int samplesQuery;
+		bool samplesPending;
+		bool samplesSorted;
+		// The terrain split into chunks with LODs, built on threadPool once
+		// the terrain is loaded and handed back through terrainBuild, so
+		// only the render thread touches terrainChunks. When chunkedTerrain
+		// is on the chunks are drawn in place of the terrain's MeshGroup,
+		// each at the coarsest LOD within terrainPixelError pixels of the
+		// full mesh.
+		bool chunkedTerrain;
+		float terrainPixelError;
+		TerrainChunks::Stats terrainStats;
+		std::unique_ptr<TerrainChunks> terrainChunks;
+		std::future<std::unique_ptr<TerrainChunks>> terrainBuild;
+		// What stands in for the terrain mesh: noise displaced in
+		// vertex.glsl, or chunks of the same noise generated on threadPool
+		// and streamed in around the camera. Both share procedural's
+		// settings.
+		enum TerrainMode { MESH_TERRAIN, PROCEDURAL_TERRAIN, STREAMED_TERRAIN };
+		int terrainMode;
+		std::unique_ptr<ProceduralTerrain> procedural;
+		ProceduralTerrain::Stats proceduralStats;
+		std::unique_ptr<TerrainStreamer> streamer;
+		// FrameBlock is written once a frame, ModelBlocks only when a
+		// model changes.
+		std::unique_ptr<UniformRing> frameUniforms;
+		std::unique_ptr<UniformRing> modelUniforms;
+		unsigned int frameNumber;
+		ThreadPool threadPool;
+		// Loads models in the background. Models are only drawn, and only
+		// shown in the GUI, once they exist.
+		ResourceManager resources;
+		// Every loaded model's transform, boxes and settings. Per frame
+		// work scans its arrays. The models below own their objects, so
+		// the scene has to outlive them.
+		Scene scene;
+		std::unique_ptr<Model> terrain;
+		std::unique_ptr<Model> water;
+		std::vector<std::unique_ptr<Model>> logs;
+		std::vector<std::unique_ptr<Model>> demoModels;
 		
 		const unsigned int height = 800;
 		const unsigned int width = 800;
+		// Time per frame the ResourceManager may spend uploading meshes.
+		const float uploadBudget = 0.004f;
+		// Time per frame the TerrainStreamer may spend uploading chunks.
+		const float streamBudget = 0.002f;
 		bool showCursor;
+		float startupSeconds;		// 0 until the first frame is shown.
+		float loadedSeconds;		// 0 until every model is loaded.
 
-		glm::vec3 rotate;
-		float scale;
 		Camera camera;
 		glm::mat4 perspective;
 
@@ -45,14 +126,19 @@ class Renderer
 
 		float deltaTime;
 		float lastFrame;
+		glm::vec3 lightPos;
+
+		Noise noise;
+		std::unique_ptr<PermSource> permSource;
 
-		void shuffle(int perm[256], int seed);
 		void initWindow();
 		void initImGui();
 		void loadModels();
-		void loadModel(const std::string path, std::shared_ptr<Model>& model);
-		void setupModels();
+		void loadModel(const std::string path, std::unique_ptr<Model>& model, std::function<void(Model&)> setup);
+		void buildTerrainChunks(const std::string& path);
+		void drawModels();
 		void showGui();
+		void reportStartup();
 		void processWindowInput();
 		static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 		static void mouseCallback(GLFWwindow* window, double xpos, double ypos);
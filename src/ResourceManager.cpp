@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <chrono>
+
+#include "ResourceManager.h"
+
+/**
+ * workerCount threads read and import files for requestMeshGroup(). They
+ * are separate from parsePool so a long import never delays work the
+ * render thread waits for, and so a worker can wait on parsePool.
+ */
+ResourceManager::ResourceManager(unsigned int workerCount, ThreadPool& parsePool,
+		Mesh::VertexFormat vertexFormat) :
+	loadCount(0), shareCount(0), requestCount(0), parsePool(parsePool), vertexFormat(vertexFormat),
+	workers(workerCount)
+{
+}
+
+ResourceManager::~ResourceManager()
+{
+	for (auto& load : loads)
+	{
+		load->read.wait();
+	}
+}
+
+/**
+ * Returns the live MeshGroup for path and importFlags, or loads a new
+ * one right away. A request for the same file still in flight is
+ * finished first. Must be called on the thread that owns the GL context.
+ */
+std::shared_ptr<const MeshGroup> ResourceManager::getMeshGroup(const std::string& path, unsigned int importFlags)
+{
+	Key key(path, importFlags);
+	std::weak_ptr<const MeshGroup>& entry = meshGroups[key];
+	if (std::shared_ptr<const MeshGroup> meshGroup = entry.lock())
+	{
+		shareCount++;
+		return meshGroup;
+	}
+
+	auto it = std::find_if(loads.begin(), loads.end(), [&key](const auto& load) { return load->key == key; });
+	if (it != loads.end())
+	{
+		std::unique_ptr<Load> load = std::move(*it);
+		loads.erase(it);
+		shareCount++;
+		return finish(*load);
+	}
+
+	std::shared_ptr<const MeshGroup> meshGroup = std::make_shared<MeshGroup>(path, importFlags, vertexFormat);
+	entry = meshGroup;
+	loadCount++;
+	return meshGroup;
+}
+
+/**
+ * Calls onReady with the MeshGroup for path and importFlags once it is
+ * loaded. A live MeshGroup is handed over immediately, otherwise
+ * onReady runs from a later update(). Must be called on the thread that
+ * owns the GL context.
+ */
+void ResourceManager::requestMeshGroup(const std::string& path, Callback onReady, unsigned int importFlags)
+{
+	requestCount++;
+	Key key(path, importFlags);
+	if (std::shared_ptr<const MeshGroup> meshGroup = meshGroups[key].lock())
+	{
+		shareCount++;
+		onReady(meshGroup);
+		return;
+	}
+
+	for (auto& load : loads)
+	{
+		if (load->key == key)
+		{
+			shareCount++;
+			load->callbacks.push_back(std::move(onReady));
+			return;
+		}
+	}
+
+	auto load = std::make_unique<Load>();
+	load->key = key;
+	load->callbacks.push_back(std::move(onReady));
+	Load* target = load.get();
+	load->read = workers.submit([target, this]() {
+		target->source = std::make_unique<MeshSource>(target->key.first, target->key.second, &parsePool);
+	});
+	loads.push_back(std::move(load));
+	loadCount++;
+}
+
+/**
+ * Uploads meshes of files that have been read, oldest request first,
+ * until budgetSeconds have passed. At least one mesh is uploaded per
+ * call so loading always moves on. Finished MeshGroups are handed to
+ * their callbacks.
+ */
+void ResourceManager::update(float budgetSeconds)
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point deadline = Clock::now() +
+		std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(budgetSeconds));
+	bool uploaded = false;
+	std::vector<std::unique_ptr<Load>> done;
+	for (auto it = loads.begin(); it != loads.end(); )
+	{
+		Load& load = **it;
+		if (load.read.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			it++;
+			continue;
+		}
+
+		while (load.meshes.size() < load.source->getMeshCount() && (!uploaded || Clock::now() < deadline))
+		{
+			load.meshes.push_back(load.source->createMesh(load.meshes.size(), vertexFormat));
+			uploaded = true;
+		}
+		if (load.meshes.size() < load.source->getMeshCount())
+			break;
+
+		done.push_back(std::move(*it));
+		it = loads.erase(it);
+	}
+
+	// Callbacks may request more files, so they run after the loop.
+	for (auto& load : done)
+	{
+		finish(*load);
+	}
+}
+
+/**
+ * Waits for the read of load, uploads what is left, stores the MeshGroup
+ * and calls every callback waiting for it.
+ */
+std::shared_ptr<const MeshGroup> ResourceManager::finish(Load& load)
+{
+	load.read.wait();
+	while (load.meshes.size() < load.source->getMeshCount())
+		load.meshes.push_back(load.source->createMesh(load.meshes.size(), vertexFormat));
+
+	std::shared_ptr<const MeshGroup> meshGroup = std::make_shared<MeshGroup>(load.key.first, std::move(load.meshes));
+	meshGroups[load.key] = meshGroup;
+	for (auto& callback : load.callbacks)
+	{
+		callback(meshGroup);
+	}
+	return meshGroup;
+}
+
+unsigned int ResourceManager::getLoadCount() const
+{
+	return loadCount;
+}
+
+unsigned int ResourceManager::getShareCount() const
+{
+	return shareCount;
+}
+
+/**
+ * How many MeshGroups are still used by at least one Model.
+ */
+std::size_t ResourceManager::getLiveCount() const
+{
+	std::size_t count = 0;
+	for (const auto& entry : meshGroups)
+	{
+		if (!entry.second.expired())
+			count++;
+	}
+	return count;
+}
+
+unsigned int ResourceManager::getRequestCount() const
+{
+	return requestCount;
+}
+
+/**
+ * How many requests still wait for their MeshGroup.
+ */
+std::size_t ResourceManager::getPendingCount() const
+{
+	std::size_t count = 0;
+	for (const auto& load : loads)
+	{
+		count += load->callbacks.size();
+	}
+	return count;
+}
+
+/**
+ * Bytes of vertex and index buffers held by the live MeshGroups.
+ */
+std::size_t ResourceManager::getGpuSize() const
+{
+	std::size_t size = 0;
+	for (const auto& entry : meshGroups)
+	{
+		if (std::shared_ptr<const MeshGroup> meshGroup = entry.second.lock())
+			size += meshGroup->getGpuSize();
+	}
+	return size;
+}
+
+Mesh::VertexFormat ResourceManager::getVertexFormat() const
+{
+	return vertexFormat;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <functional>
+#include <future>
+
+#include "MeshGroup.h"
+#include "MeshSource.h"
+#include "ThreadPool.h"
+
+/**
+ * Hands out MeshGroups keyed by path and import flags, so a file placed
+ * many times is imported and uploaded once. The manager only holds weak
+ * references: a MeshGroup is freed when the last Model using it is, and
+ * a later request loads it again.
+ *
+ * requestMeshGroup() loads in the background. Files are read and
+ * imported on the manager's own workers, which split large OBJ files
+ * across parsePool, and update() uploads the results on the render
+ * thread a few meshes at a time.
+ */
+class ResourceManager
+{
+	public:
+		typedef std::function<void(std::shared_ptr<const MeshGroup>)> Callback;
+
+		ResourceManager(unsigned int workerCount, ThreadPool& parsePool,
+				Mesh::VertexFormat vertexFormat = Mesh::FULL);
+		~ResourceManager();
+		std::shared_ptr<const MeshGroup> getMeshGroup(const std::string& path,
+				unsigned int importFlags = MeshGroup::DEFAULT_IMPORT_FLAGS);
+		void requestMeshGroup(const std::string& path, Callback onReady,
+				unsigned int importFlags = MeshGroup::DEFAULT_IMPORT_FLAGS);
+		void update(float budgetSeconds);
+		unsigned int getLoadCount() const;
+		unsigned int getShareCount() const;
+		std::size_t getLiveCount() const;
+		unsigned int getRequestCount() const;
+		std::size_t getPendingCount() const;
+		std::size_t getGpuSize() const;
+		Mesh::VertexFormat getVertexFormat() const;
+
+	private:
+		typedef std::pair<std::string, unsigned int> Key;
+
+		// A file being read on a worker or uploaded by update().
+		struct Load
+		{
+			Key key;
+			std::unique_ptr<MeshSource> source;	// Set by the worker.
+			std::future<void> read;
+			std::vector<std::unique_ptr<Mesh>> meshes;	// Uploaded so far.
+			std::vector<Callback> callbacks;
+		};
+
+		std::map<Key, std::weak_ptr<const MeshGroup>> meshGroups;
+		std::vector<std::unique_ptr<Load>> loads;	// In request order.
+		unsigned int loadCount;		// Requests that loaded a file.
+		unsigned int shareCount;	// Requests served by a live or loading MeshGroup.
+		unsigned int requestCount;	// Calls to requestMeshGroup().
+		ThreadPool& parsePool;
+		Mesh::VertexFormat vertexFormat;	// Used for every mesh uploaded.
+		ThreadPool workers;
+
+		std::shared_ptr<const MeshGroup> finish(Load& load);
+};
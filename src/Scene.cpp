@@ -0,0 +1,227 @@
+#include "Scene.h"
+
+const std::uint32_t Scene::NO_INDEX;
+const std::size_t Scene::BATCH_MIN;
+
+Scene::Scene() {}
+
+Scene::~Scene() {}
+
+/**
+ * Adds an object showing meshGroup, whose meshes fit in localBox. It
+ * starts with the identity transform, zeroed settings and an opaque
+ * render state without culling. model is kept for whoever owns the
+ * object and may be null.
+ */
+Scene::Handle Scene::add(const MeshGroup* meshGroup, const BoundingBox& localBox, Model* model)
+{
+	std::uint32_t slot;
+	if (freeSlots.empty())
+	{
+		slot = indices.size();
+		indices.push_back(NO_INDEX);
+		generations.push_back(0);
+	}
+	else
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	indices[slot] = transforms.size();
+
+	transforms.push_back(Transform());
+	localBoxes.push_back(localBox);
+	worldBoxes.push_back(localBox);
+	settings.push_back(FragmentSettings());
+	renderStates.push_back(RenderState());
+	meshGroups.push_back(meshGroup);
+	models.push_back(model);
+	touched.push_back(0);
+	slots.push_back(slot);
+	return { slot, generations[slot] };
+}
+
+/**
+ * Removes the object, moving the last object into its place. Handles
+ * to it stop being valid. Removing an object twice does nothing.
+ */
+void Scene::remove(Handle handle)
+{
+	if (!contains(handle))
+		return;
+	std::uint32_t index = indices[handle.slot];
+	std::uint32_t last = transforms.size() - 1;
+
+	transforms[index] = transforms[last];
+	transforms.pop_back();
+	localBoxes[index] = localBoxes[last];
+	localBoxes.pop_back();
+	worldBoxes.removeSwap(index);
+	settings[index] = settings[last];
+	settings.pop_back();
+	renderStates[index] = renderStates[last];
+	renderStates.pop_back();
+	meshGroups[index] = meshGroups[last];
+	meshGroups.pop_back();
+	models[index] = models[last];
+	models.pop_back();
+	touched[index] = touched[last];
+	touched.pop_back();
+	slots[index] = slots[last];
+	slots.pop_back();
+
+	if (index != last)
+		indices[slots[index]] = index;
+	indices[handle.slot] = NO_INDEX;
+	generations[handle.slot]++;
+	freeSlots.push_back(handle.slot);
+}
+
+bool Scene::contains(Handle handle) const
+{
+	return handle.slot < indices.size() && indices[handle.slot] != NO_INDEX &&
+		generations[handle.slot] == handle.generation;
+}
+
+/**
+ * Where the object is in the arrays, until the next remove(). handle
+ * must be valid, like the handles taken by the getters below.
+ */
+std::size_t Scene::indexOf(Handle handle) const
+{
+	return indices[handle.slot];
+}
+
+std::size_t Scene::size() const
+{
+	return transforms.size();
+}
+
+/**
+ * Recomputes the matrix and world box of every object whose transform
+ * changed. Returns how many did. Only transforms handed out by
+ * getTransform() since the last call are looked at. With many changes
+ * the world boxes go through TransformBatch::transformBoxes() at once.
+ */
+unsigned int Scene::update()
+{
+	changed.clear();
+	for (std::size_t i = 0; i < touched.size(); i++)
+	{
+		if (touched[i] && transforms[i].isDirty())
+			changed.push_back(i);
+		touched[i] = 0;
+	}
+
+	if (changed.size() < BATCH_MIN)
+	{
+		for (std::uint32_t i : changed)
+		{
+			transforms[i].update();
+			worldBoxes.set(i, Frustum::transform(localBoxes[i], transforms[i].getMatrix()));
+		}
+		return changed.size();
+	}
+
+	batchBoxes.clear();
+	batchMatrices.clear();
+	for (std::uint32_t i : changed)
+	{
+		transforms[i].update();
+		batchBoxes.push_back(localBoxes[i]);
+		batchMatrices.push_back(transforms[i].getMatrix());
+	}
+	TransformBatch::transformBoxes(batchMatrices.data(), batchBoxes.data(), changed.size(), batchWorldBoxes);
+	for (std::size_t k = 0; k < changed.size(); k++)
+	{
+		std::uint32_t i = changed[k];
+		worldBoxes.minX[i] = batchWorldBoxes.minX[k];
+		worldBoxes.minY[i] = batchWorldBoxes.minY[k];
+		worldBoxes.minZ[i] = batchWorldBoxes.minZ[k];
+		worldBoxes.maxX[i] = batchWorldBoxes.maxX[k];
+		worldBoxes.maxY[i] = batchWorldBoxes.maxY[k];
+		worldBoxes.maxZ[i] = batchWorldBoxes.maxZ[k];
+	}
+	return changed.size();
+}
+
+/**
+ * Sets visible[i] for each object whose world box intersects frustum.
+ * Returns how many do. Call update() first.
+ */
+std::size_t Scene::cull(const Frustum& frustum, std::vector<unsigned char>& visible) const
+{
+	return frustum.cull(worldBoxes, visible);
+}
+
+/**
+ * The object's transform, to be changed. Changes show after the next
+ * update().
+ */
+Transform& Scene::getTransform(Handle handle)
+{
+	std::size_t index = indexOf(handle);
+	touched[index] = 1;
+	return transforms[index];
+}
+
+/**
+ * The object's model matrix as of the last update().
+ */
+const glm::mat4& Scene::getMatrix(Handle handle) const
+{
+	return transforms[indexOf(handle)].getMatrix();
+}
+
+FragmentSettings& Scene::getSettings(Handle handle)
+{
+	return settings[indexOf(handle)];
+}
+
+RenderState& Scene::getRenderState(Handle handle)
+{
+	return renderStates[indexOf(handle)];
+}
+
+const BoundingBox& Scene::getLocalBox(Handle handle) const
+{
+	return localBoxes[indexOf(handle)];
+}
+
+/**
+ * The world space box as of the last update().
+ */
+BoundingBox Scene::getWorldBox(Handle handle) const
+{
+	return worldBoxes.get(indexOf(handle));
+}
+
+const std::vector<Transform>& Scene::getTransforms() const
+{
+	return transforms;
+}
+
+const std::vector<FragmentSettings>& Scene::getSettings() const
+{
+	return settings;
+}
+
+const std::vector<RenderState>& Scene::getRenderStates() const
+{
+	return renderStates;
+}
+
+const BoxList& Scene::getWorldBoxes() const
+{
+	return worldBoxes;
+}
+
+const std::vector<const MeshGroup*>& Scene::getMeshGroups() const
+{
+	return meshGroups;
+}
+
+const std::vector<Model*>& Scene::getModels() const
+{
+	return models;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Transform.h"
+#include "TransformBatch.h"
+#include "Frustum.h"
+#include "FragmentSettings.h"
+#include "RenderState.h"
+
+class MeshGroup;
+class Model;
+
+/**
+ * The objects of a scene as parallel arrays, one element per object:
+ * transforms, local and world space boxes, fragment settings, render
+ * states, meshes and the Model each object belongs to. Per frame work like updating
+ * matrices, culling and building draw lists is a linear scan over the
+ * arrays it needs instead of a walk over heap allocated models.
+ *
+ * Objects are reached through handles, which stay valid while other
+ * objects are added and removed. Removing an object moves the last one
+ * into its place, so array indices do change and are only good until
+ * the next remove(). A handle to a removed object is recognised by its
+ * generation, even after its slot is reused.
+ */
+class Scene
+{
+	public:
+		struct Handle
+		{
+			std::uint32_t slot;
+			std::uint32_t generation;
+		};
+
+		Scene();
+		~Scene();
+		Handle add(const MeshGroup* meshGroup, const BoundingBox& localBox, Model* model = nullptr);
+		void remove(Handle handle);
+		bool contains(Handle handle) const;
+		std::size_t indexOf(Handle handle) const;
+		std::size_t size() const;
+
+		unsigned int update();
+		std::size_t cull(const Frustum& frustum, std::vector<unsigned char>& visible) const;
+
+		Transform& getTransform(Handle handle);
+		const glm::mat4& getMatrix(Handle handle) const;
+		FragmentSettings& getSettings(Handle handle);
+		RenderState& getRenderState(Handle handle);
+		const BoundingBox& getLocalBox(Handle handle) const;
+		BoundingBox getWorldBox(Handle handle) const;
+
+		// The arrays themselves, indexed by indexOf().
+		const std::vector<Transform>& getTransforms() const;
+		const std::vector<FragmentSettings>& getSettings() const;
+		const std::vector<RenderState>& getRenderStates() const;
+		const BoxList& getWorldBoxes() const;
+		const std::vector<const MeshGroup*>& getMeshGroups() const;
+		const std::vector<Model*>& getModels() const;
+
+	private:
+		static const std::uint32_t NO_INDEX = 0xFFFFFFFF;
+		// update() hands at least this many changed transforms to
+		// TransformBatch at once. Fewer are not worth gathering.
+		static const std::size_t BATCH_MIN = 64;
+
+		// Parallel arrays of the objects.
+		std::vector<Transform> transforms;
+		std::vector<BoundingBox> localBoxes;
+		BoxList worldBoxes;
+		std::vector<FragmentSettings> settings;
+		std::vector<RenderState> renderStates;
+		std::vector<const MeshGroup*> meshGroups;
+		std::vector<Model*> models;
+		// Set when the transform is handed out for changes, so update()
+		// only looks at those transforms.
+		std::vector<unsigned char> touched;
+		std::vector<std::uint32_t> slots;		// Object to its handle's slot.
+
+		// Handle slots to objects.
+		std::vector<std::uint32_t> indices;		// NO_INDEX for a free slot.
+		std::vector<std::uint32_t> generations;
+		std::vector<std::uint32_t> freeSlots;
+
+		// Scratch space of update(), kept to reuse the allocations.
+		std::vector<std::uint32_t> changed;
+		std::vector<BoundingBox> batchBoxes;
+		std::vector<glm::mat4> batchMatrices;
+		BoxList batchWorldBoxes;
+};
@@ -4,10 +4,19 @@
 #include <sstream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "Shader.h"
-Shader::Shader(std::string vertexShaderPath, std::string fragmentShaderPath)
+#include "GLDebug.h"
+
+/**
+ * Each of defines is added to both shaders as "#define <define>" right
+ * after the #version line, e.g. "PERM_TEXTURE" or "OCTAVES 4".
+ */
+Shader::Shader(std::string vertexShaderPath, std::string fragmentShaderPath,
+		const std::vector<std::string>& defines) :
+	defines(defines)
 {
 	id = glCreateProgram();
 
@@ -15,12 +24,74 @@ Shader::Shader(std::string vertexShaderPath, std::string fragmentShaderPath)
 	compileShader(fragmentShaderPath, GL_FRAGMENT_SHADER);
 }
 
-Shader::~Shader() {}
+/**
+ * An empty program for fromBinary().
+ */
+Shader::Shader()
+{
+	id = glCreateProgram();
+}
+
+/**
+ * Whether programs can be saved and loaded as driver binaries, which
+ * needs GL 4.1 or ARB_get_program_binary and at least one format.
+ */
+bool Shader::supportsBinaries()
+{
+	if (!glad_glGetProgramBinary || !glad_glProgramBinary || !glad_glProgramParameteri)
+		return false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+/**
+ * Creates a linked program from a binary made by getBinary(). Returns
+ * nullptr when the driver rejects it, which it may do after any driver
+ * update, so callers must be ready to compile from source instead.
+ */
+std::unique_ptr<Shader> Shader::fromBinary(unsigned int format, const std::vector<char>& binary)
+{
+	std::unique_ptr<Shader> shader(new Shader());
+	glProgramBinary(shader->id, format, binary.data(), binary.size());
+
+	int success;
+	glGetProgramiv(shader->id, GL_LINK_STATUS, &success);
+	if (!success)
+		return nullptr;
+
+	shader->reflectUniforms();
+	return shader;
+}
+
+/**
+ * Gets the driver's binary of the linked program. Returns false if
+ * there is none.
+ */
+bool Shader::getBinary(unsigned int& format, std::vector<char>& binary) const
+{
+	GLint length = 0;
+	glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return false;
+
+	binary.resize(length);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(id, length, &length, &binaryFormat, binary.data());
+	binary.resize(length);
+	format = binaryFormat;
+	return length > 0;
+}
+
+Shader::~Shader()
+{
+	glDeleteProgram(id);
+}
 
 bool Shader::compileShader(std::string shaderPath, unsigned int type)
 {
 	unsigned int shader = glCreateShader(type);
-	std::string shaderSource = readShaderFile(shaderPath); 
+	std::string shaderSource = addDefines(readShaderFile(shaderPath));
 	const char* sSource = shaderSource.c_str();
 	glShaderSource(shader, 1, &sSource, nullptr);
 	glCompileShader(shader);
@@ -58,6 +129,9 @@ bool Shader::compileShader(std::string shaderPath, unsigned int type)
 
 bool Shader::link()
 {
+	// Ask the driver to keep a binary around for getBinary().
+	if (glad_glProgramParameteri)
+		glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(id);
 
 	char infoLog[1024];
@@ -75,20 +149,121 @@ bool Shader::link()
 	{
 		glDeleteShader(shader);
 	}
+
+	if (success)
+		reflectUniforms();
 	
 	return success;
 }
 
+/**
+ * Caches the location of every active uniform so no setUniform call has
+ * to ask the driver. Arrays are stored under both "name[0]", which is
+ * what the driver reports, and "name".
+ */
+void Shader::reflectUniforms()
+{
+	uniformLocations.clear();
+
+	int uniformCount = 0;
+	int maxNameLength = 0;
+	glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<char> name(maxNameLength + 1);
+	for (int i = 0; i < uniformCount; i++)
+	{
+		int length = 0;
+		int size = 0;
+		GLenum type;
+		glGetActiveUniform(id, i, name.size(), &length, &size, &type, name.data());
+		std::string uniform(name.data(), length);
+
+		int location = glGetUniformLocation(id, uniform.c_str());
+		// Uniforms inside a uniform block have no location.
+		if (location == -1)
+			continue;
+
+		uniformLocations[uniform] = location;
+		std::size_t bracket = uniform.find('[');
+		if (bracket != std::string::npos)
+			uniformLocations[uniform.substr(0, bracket)] = location;
+	}
+}
+
+/**
+ * Returns the cached location of a uniform, or -1 if the program has no
+ * active uniform by that name. Resolve a Uniform handle with
+ * getUniform() on hot paths instead of calling this every frame.
+ */
+int Shader::getUniformLocation(const char *uniform) const
+{
+	auto it = uniformLocations.find(uniform);
+	if (it != uniformLocations.end())
+		return it->second;
+
+	// Not active, often because the compiler removed it. Only report
+	// it the first time.
+	std::cout << "ERROR: Could not find uniform " << uniform << std::endl;
+	uniformLocations.emplace(uniform, -1);
+	return -1;
+}
+
+/*
+ * Reads a shader source. A line of the form #include "file" is replaced
+ * by that file, looked up next to shaderPath, so vertex.glsl and
+ * fragment.glsl can share code. #line directives keep the line numbers
+ * in compile errors matching each file.
+ */
 std::string Shader::readShaderFile(std::string shaderPath)
 {
 	std::ifstream in(shaderPath);
-	std::string buffer = [&in] {
-		std::ostringstream ss{};
-		ss << in.rdbuf();
-		return ss.str();
-	}();
-	in.close();
-	return buffer;
+	std::size_t slash = shaderPath.find_last_of('/');
+	std::string directory = slash == std::string::npos ? "" : shaderPath.substr(0, slash + 1);
+
+	std::ostringstream source;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(in, line))
+	{
+		lineNumber++;
+		std::size_t start = line.find_first_not_of(" \t");
+		if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
+		{
+			std::size_t open = line.find('"', start);
+			std::size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+			if (close != std::string::npos)
+			{
+				source << "#line 1\n" << readShaderFile(directory + line.substr(open + 1, close - open - 1))
+					<< "#line " << lineNumber + 1 << "\n";
+				continue;
+			}
+		}
+		source << line << "\n";
+	}
+	return source.str();
+}
+
+std::string Shader::addDefines(const std::string& source) const
+{
+	if (defines.empty())
+		return source;
+
+	std::string lines;
+	for (const auto& define : defines)
+		lines += "#define " + define + "\n";
+
+	// #version must stay the first line.
+	std::size_t version = source.find("#version");
+	std::size_t insert = version == std::string::npos ? 0 : source.find('\n', version);
+	if (insert == std::string::npos)
+		return source + "\n" + lines;
+	if (version != std::string::npos)
+		insert++;
+	// Keep the line numbers in compile errors matching the file.
+	int line = std::count(source.begin(), source.begin() + insert, '\n') + 1;
+	lines += "#line " + std::to_string(line) + "\n";
+	return source.substr(0, insert) + lines + source.substr(insert);
 }
 
 void Shader::use() const
@@ -101,61 +276,109 @@ unsigned int Shader::getId() const
 	return id;
 }
 
-void Shader::setUniform1iv(const char *uniform, int count, int* value) const
+void Shader::setUniform1iv(const char *uniform, int count, const int* value) const
 {
-	GLint uniformLocation = glGetUniformLocation(id, uniform);
+	GLint uniformLocation = getUniformLocation(uniform);
 	glUniform1iv(uniformLocation, count, value);
-	logUniformError(uniformLocation, uniform);
+	GLDebug::checkErrors(uniform);
 }
 
 void Shader::setUniform1i(const char *uniform, int value) const
 {
-	GLint uniformLocation = glGetUniformLocation(id, uniform);
+	GLint uniformLocation = getUniformLocation(uniform);
 	glUniform1i(uniformLocation, value);
-	logUniformError(uniformLocation, uniform);
+	GLDebug::checkErrors(uniform);
+}
+
+void Shader::setUniform1ui(const char *uniform, unsigned int value) const
+{
+	GLint uniformLocation = getUniformLocation(uniform);
+	glUniform1ui(uniformLocation, value);
+	GLDebug::checkErrors(uniform);
 }
 
 void Shader::setUniform1f(const char *uniform, float value) const
 {
-	GLint uniformLocation = glGetUniformLocation(id, uniform);
+	GLint uniformLocation = getUniformLocation(uniform);
 	glUniform1f(uniformLocation, value);
-	logUniformError(uniformLocation, uniform);
+	GLDebug::checkErrors(uniform);
 }
 
 void Shader::setUniformMatrix4fv(const char *uniform, const glm::mat4 &matrix) const
 {
-	GLint uniformLocation = glGetUniformLocation(id, uniform);
+	GLint uniformLocation = getUniformLocation(uniform);
 	glUniformMatrix4fv(uniformLocation, 1, GL_FALSE, glm::value_ptr(matrix));
-	logUniformError(uniformLocation, uniform);
+	GLDebug::checkErrors(uniform);
 }
 
 void Shader::setUniform3fv(const char *uniform, const glm::vec3 &vec) const
 {
-	GLint uniformLocation = glGetUniformLocation(id, uniform);
+	GLint uniformLocation = getUniformLocation(uniform);
 	glUniform3fv(uniformLocation, 1, glm::value_ptr(vec));
-	logUniformError(uniformLocation, uniform);
+	GLDebug::checkErrors(uniform);
 }
 
 void Shader::setUniform4fv(const char *uniform, const glm::vec4 &vec) const
 {
-	GLint uniformLocation = glGetUniformLocation(id, uniform);
+	GLint uniformLocation = getUniformLocation(uniform);
 	glUniform4fv(uniformLocation, 1, glm::value_ptr(vec));
-	logUniformError(uniformLocation, uniform);
+	GLDebug::checkErrors(uniform);
 }
 
-void Shader::logUniformError(GLint uniformLocation, const char *uniform) const
+/**
+ * Whether the program has an active uniform by that name. Variants
+ * compiled with defines can lose uniforms their code does not use.
+ */
+bool Shader::hasUniform(const char *uniform) const
 {
-	if (uniformLocation == -1)
-	{
-		std::cout << "ERROR: Could not find uniform " << uniform << std::endl;
-	}
-	GLenum status = glGetError();
-	while (status != GL_NO_ERROR)
+	auto it = uniformLocations.find(uniform);
+	return it != uniformLocations.end() && it->second != -1;
+}
+
+/**
+ * Whether the program has an active uniform block by that name.
+ */
+bool Shader::hasUniformBlock(const char *block) const
+{
+	return glGetUniformBlockIndex(id, block) != GL_INVALID_INDEX;
+}
+
+/**
+ * Connects a uniform block to a binding point. GLSL 330 has no layout
+ * binding qualifier, so this must be done after link().
+ */
+void Shader::bindUniformBlock(const char *block, unsigned int binding) const
+{
+	GLuint index = glGetUniformBlockIndex(id, block);
+	if (index == GL_INVALID_INDEX)
 	{
-		if (status == GL_INVALID_OPERATION)
-		{
-			std::cout << "ERROR GL_INVALID_OPERATION: Setting " << uniform << std::endl;
-		}
-		status = glGetError();
+		std::cout << "ERROR: Could not find uniform block " << block << std::endl;
+		return;
 	}
+	glUniformBlockBinding(id, index, binding);
+}
+
+void Shader::setUniform(Uniform<int> uniform, int value) const
+{
+	glUniform1i(uniform.getLocation(), value);
+}
+
+void Shader::setUniform(Uniform<float> uniform, float value) const
+{
+	glUniform1f(uniform.getLocation(), value);
+}
+
+void Shader::setUniform(Uniform<glm::vec3> uniform, const glm::vec3 &vec) const
+{
+	glUniform3fv(uniform.getLocation(), 1, glm::value_ptr(vec));
+}
+
+void Shader::setUniform(Uniform<glm::vec4> uniform, const glm::vec4 &vec) const
+{
+	glUniform4fv(uniform.getLocation(), 1, glm::value_ptr(vec));
+}
+
+void Shader::setUniform(Uniform<glm::mat4> uniform, const glm::mat4 &matrix) const
+{
+	glUniformMatrix4fv(uniform.getLocation(), 1, GL_FALSE, glm::value_ptr(matrix));
 }
@@ -7,19 +7,62 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <memory>
 #include <glm/glm.hpp>
 
+/*
+ * A uniform location resolved once by Shader::getUniform(). Setting a
+ * uniform through a handle skips the name lookup entirely. The type
+ * only picks the matching Shader::setUniform() overload.
+ */
+template <typename T>
+class Uniform
+{
+	public:
+		Uniform() : location(-1) {}
+		explicit Uniform(int location) : location(location) {}
+		int getLocation() const { return location; }
+		bool isValid() const { return location != -1; }
+
+	private:
+		int location;
+};
+
 class Shader
 {
 	public:
-		Shader(std::string vertexShaderPath, std::string fragmentShaderPath);
+		Shader(std::string vertexShaderPath, std::string fragmentShaderPath,
+				const std::vector<std::string>& defines = {});
 		~Shader();
+		static std::unique_ptr<Shader> fromBinary(unsigned int format, const std::vector<char>& binary);
+		static bool supportsBinaries();
+		static std::string readShaderFile(std::string shaderPath);
+		bool getBinary(unsigned int& format, std::vector<char>& binary) const;
 		unsigned int getId() const;
 		bool compileShader(std::string shaderPath, unsigned int type);
 		bool link();
 		void use() const;
-		void setUniform1iv(const char *uniform, int count, int* value) const;
+		int getUniformLocation(const char *uniform) const;
+		bool hasUniform(const char *uniform) const;
+		bool hasUniformBlock(const char *block) const;
+		void bindUniformBlock(const char *block, unsigned int binding) const;
+		template <typename T>
+		Uniform<T> getUniform(const char *uniform) const
+		{
+			return Uniform<T>(getUniformLocation(uniform));
+		}
+
+		void setUniform(Uniform<int> uniform, int value) const;
+		void setUniform(Uniform<float> uniform, float value) const;
+		void setUniform(Uniform<glm::vec3> uniform, const glm::vec3 &vec) const;
+		void setUniform(Uniform<glm::vec4> uniform, const glm::vec4 &vec) const;
+		void setUniform(Uniform<glm::mat4> uniform, const glm::mat4 &matrix) const;
+
+		// Look the location up by name in the cache filled by link().
+		void setUniform1iv(const char *uniform, int count, const int* value) const;
 		void setUniform1i(const char *uniform, int value) const;
+		void setUniform1ui(const char *uniform, unsigned int value) const;
 		void setUniform1f(const char *uniform, float value) const;
 		void setUniformMatrix4fv(const char *uniform, const glm::mat4 &matrix) const;
 		void setUniform3fv(const char *uniform, const glm::vec3 &vec) const;
@@ -28,6 +71,11 @@ class Shader
 	private:
 		unsigned int id;
 		std::vector<unsigned int> shaders;
-		std::string readShaderFile(std::string shaderPath);
-		void logUniformError(GLint uniformLocation, const char *uniform) const;
+		std::vector<std::string> defines;
+		// Every active uniform, filled in by link(). Names that are not
+		// active are added with location -1 the first time they are used.
+		mutable std::unordered_map<std::string, int> uniformLocations;
+		Shader();
+		std::string addDefines(const std::string& source) const;
+		void reflectUniforms();
 };
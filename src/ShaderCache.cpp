@@ -0,0 +1,202 @@
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "ShaderCache.h"
+#include "Hash.h"
+
+namespace
+{
+	const char BINARY_MAGIC[4] = { 'G', 'L', 'P', 'B' };
+	const std::uint32_t BINARY_VERSION = 1;
+
+	std::string glString(GLenum name)
+	{
+		const GLubyte* value = glGetString(name);
+		return value ? reinterpret_cast<const char*>(value) : "";
+	}
+}
+
+ShaderCache::ShaderCache(const std::string& vertexShaderPath, const std::string& fragmentShaderPath,
+		const std::vector<std::string>& commonDefines, std::function<void(Shader&)> setup,
+		const std::string& binaryDirectory) :
+	vertexShaderPath(vertexShaderPath), fragmentShaderPath(fragmentShaderPath),
+	commonDefines(commonDefines), setup(setup), stats()
+{
+	if (binaryDirectory.empty() || !Shader::supportsBinaries())
+		return;
+
+	std::error_code error;
+	std::filesystem::create_directories(binaryDirectory, error);
+	if (error)
+	{
+		std::cerr << "Can not create shader cache " << binaryDirectory << ": " << error.message() << std::endl;
+		return;
+	}
+	this->binaryDirectory = binaryDirectory;
+
+	binaryKeyPrefix = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION) + "\n" +
+		Shader::readShaderFile(vertexShaderPath) + "\n" + Shader::readShaderFile(fragmentShaderPath) + "\n";
+}
+
+/**
+ * Returns the program for the given defines, building it the first
+ * time. The order of defines matters for the lookup, so callers should
+ * always build them in the same order. Restores the current program
+ * after setting up a new one.
+ */
+Shader& ShaderCache::get(const std::vector<std::string>& defines)
+{
+	std::string key;
+	for (const auto& define : defines)
+		key += define + ";";
+
+	auto it = programs.find(key);
+	if (it != programs.end())
+		return *it->second;
+
+	auto start = std::chrono::steady_clock::now();
+	std::unique_ptr<Shader> shader = build(defines);
+
+	GLint current = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+	shader->use();
+	setup(*shader);
+	glUseProgram(current);
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	stats.seconds += elapsed.count();
+
+	Shader& result = *shader;
+	programs.emplace(key, std::move(shader));
+	return result;
+}
+
+/**
+ * Loads the program from the binary cache, or compiles it and adds it
+ * to the cache.
+ */
+std::unique_ptr<Shader> ShaderCache::build(const std::vector<std::string>& defines)
+{
+	std::vector<std::string> allDefines = commonDefines;
+	allDefines.insert(allDefines.end(), defines.begin(), defines.end());
+
+	std::string binaryKey;
+	std::string binaryPath;
+	if (!binaryDirectory.empty())
+	{
+		binaryKey = binaryKeyPrefix;
+		for (const auto& define : allDefines)
+			binaryKey += "#define " + define + "\n";
+
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(Hash::fnv1a(binaryKey)));
+		binaryPath = binaryDirectory + "/" + name;
+
+		std::unique_ptr<Shader> shader = loadBinary(binaryPath, binaryKey);
+		if (shader)
+		{
+			stats.loaded++;
+			return shader;
+		}
+	}
+
+	auto shader = std::make_unique<Shader>(vertexShaderPath, fragmentShaderPath, allDefines);
+	stats.compiled++;
+	if (!shader->link())
+	{
+		std::cerr << "Failed to build shader variant";
+		for (const auto& define : allDefines)
+			std::cerr << " " << define;
+		std::cerr << std::endl;
+		return shader;
+	}
+
+	if (!binaryPath.empty())
+		saveBinary(binaryPath, binaryKey, *shader);
+	return shader;
+}
+
+/**
+ * Returns nullptr when there is no entry, the entry was made for a
+ * different key, or the driver rejects the binary.
+ */
+std::unique_ptr<Shader> ShaderCache::loadBinary(const std::string& path, const std::string& key)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return nullptr;
+
+	char magic[4];
+	std::uint32_t version = 0, format = 0;
+	std::uint64_t keySize = 0, binarySize = 0;
+	in.read(magic, sizeof(magic));
+	in.read(reinterpret_cast<char*>(&version), sizeof(version));
+	in.read(reinterpret_cast<char*>(&format), sizeof(format));
+	in.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
+	in.read(reinterpret_cast<char*>(&binarySize), sizeof(binarySize));
+	if (!in || std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) != 0 || version != BINARY_VERSION ||
+			keySize != key.size())
+		return nullptr;
+
+	// The whole key is stored so a hash collision can not load the
+	// wrong program.
+	std::string storedKey(keySize, '\0');
+	std::vector<char> binary(binarySize);
+	in.read(&storedKey[0], keySize);
+	in.read(binary.data(), binarySize);
+	if (!in || storedKey != key)
+		return nullptr;
+
+	std::unique_ptr<Shader> shader = Shader::fromBinary(format, binary);
+	if (!shader)
+		stats.rejected++;
+	return shader;
+}
+
+void ShaderCache::saveBinary(const std::string& path, const std::string& key, const Shader& shader) const
+{
+	unsigned int format;
+	std::vector<char> binary;
+	if (!shader.getBinary(format, binary))
+		return;
+
+	std::uint32_t version = BINARY_VERSION, binaryFormat = format;
+	std::uint64_t keySize = key.size(), binarySize = binary.size();
+
+	// Write to a temporary file first so a crash never leaves half an
+	// entry behind.
+	std::string temporary = path + ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+		out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+		out.write(reinterpret_cast<const char*>(&binaryFormat), sizeof(binaryFormat));
+		out.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+		out.write(reinterpret_cast<const char*>(&binarySize), sizeof(binarySize));
+		out.write(key.data(), keySize);
+		out.write(binary.data(), binarySize);
+		if (!out)
+			return;
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+}
+
+/**
+ * How many programs have been built.
+ */
+std::size_t ShaderCache::size() const
+{
+	return programs.size();
+}
+
+const ShaderCache::Stats& ShaderCache::getStats() const
+{
+	return stats;
+}
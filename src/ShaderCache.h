@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Shader.h"
+
+/**
+ * Compiles one program per set of defines on first use and keeps it.
+ * Every program gets the common defines first, then its own. setup is
+ * called once on each new program, while it is in use, to bind uniform
+ * blocks and set uniforms that never change.
+ *
+ * When binaryDirectory is not empty, linked programs are also saved
+ * there as driver binaries and loaded back on later runs instead of
+ * compiling. A binary is keyed by a hash of both shader sources, the
+ * defines and the GL vendor, renderer and version strings, so editing a
+ * shader or updating the driver just makes new entries.
+ */
+
+class ShaderCache
+{
+	public:
+		struct Stats
+		{
+			unsigned int compiled;		// built from source
+			unsigned int loaded;		// loaded from a binary
+			unsigned int rejected;		// binaries the driver refused
+			double seconds;				// total time spent building programs
+		};
+
+		ShaderCache(const std::string& vertexShaderPath, const std::string& fragmentShaderPath,
+				const std::vector<std::string>& commonDefines, std::function<void(Shader&)> setup,
+				const std::string& binaryDirectory = "");
+		Shader& get(const std::vector<std::string>& defines);
+		std::size_t size() const;
+		const Stats& getStats() const;
+
+	private:
+		std::string vertexShaderPath;
+		std::string fragmentShaderPath;
+		std::vector<std::string> commonDefines;
+		std::function<void(Shader&)> setup;
+		std::unordered_map<std::string, std::unique_ptr<Shader>> programs;
+
+		std::string binaryDirectory;
+		std::string binaryKeyPrefix;	// sources and driver, the same for every program.
+		Stats stats;
+
+		std::unique_ptr<Shader> build(const std::vector<std::string>& defines);
+		std::unique_ptr<Shader> loadBinary(const std::string& path, const std::string& key);
+		void saveBinary(const std::string& path, const std::string& key, const Shader& shader) const;
+};
@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+#include "TerrainChunks.h"
+
+/**
+ * Splits terrain into chunksPerSide by chunksPerSide chunks by the
+ * centroid of each triangle and builds lodCount LODs for each.
+ */
+TerrainChunks::TerrainChunks(const MeshData& terrain, int chunksPerSide, int lodCount) :
+	lodCount(glm::clamp(lodCount, 1, MAX_LOD_COUNT)), uploaded(false)
+{
+	const BoundingBox& box = terrain.boundingBox;
+	std::size_t triangleCount = terrain.indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	int sides = std::max(chunksPerSide, 1);
+	glm::vec2 chunkSize(box.width / sides, box.depth / sides);
+	// The grid spacing of LOD 0, assuming every quad is split into two
+	// triangles.
+	float spacing = std::sqrt(box.width * box.depth / std::max<std::size_t>(triangleCount / 2, 1));
+
+	std::vector<std::vector<std::size_t>> chunkTriangles(sides * sides);
+	for (std::size_t t = 0; t < triangleCount; t++)
+	{
+		glm::vec3 centroid(0);
+		for (int k = 0; k < 3; k++)
+			centroid += terrain.vertices[terrain.indices[3 * t + k]].position / 3.0f;
+		int cx = chunkSize.x > 0 ? glm::clamp(int((centroid.x - box.x) / chunkSize.x), 0, sides - 1) : 0;
+		int cz = chunkSize.y > 0 ? glm::clamp(int((centroid.z - box.z) / chunkSize.y), 0, sides - 1) : 0;
+		chunkTriangles[cz * sides + cx].push_back(t);
+	}
+
+	std::vector<unsigned int> remap(terrain.vertices.size(), UINT_MAX);
+	for (int c = 0; c < sides * sides; c++)
+	{
+		if (chunkTriangles[c].empty())
+			continue;
+
+		MeshData base;
+		for (std::size_t t : chunkTriangles[c])
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int index = terrain.indices[3 * t + k];
+				if (remap[index] == UINT_MAX)
+				{
+					remap[index] = base.vertices.size();
+					base.vertices.push_back(terrain.vertices[index]);
+				}
+				base.indices.push_back(remap[index]);
+			}
+		}
+		for (std::size_t t : chunkTriangles[c])
+		{
+			for (int k = 0; k < 3; k++)
+				remap[terrain.indices[3 * t + k]] = UINT_MAX;
+		}
+
+		glm::vec2 origin(box.x + (c % sides) * chunkSize.x, box.z + (c / sides) * chunkSize.y);
+		Chunk chunk;
+		chunk.lods.resize(this->lodCount);
+		chunk.lods[0].error = 0;
+		float maxError = 0;
+		for (int l = 1; l < this->lodCount; l++)
+		{
+			chunk.lods[l].data = simplify(base, origin, chunkSize, spacing * (1 << l), chunk.lods[l].error);
+			// A lattice too coarse for the chunk keeps the LOD before it.
+			if (chunk.lods[l].data.indices.empty())
+			{
+				chunk.lods[l].data = chunk.lods[l - 1].data.indices.empty() ? base : chunk.lods[l - 1].data;
+				chunk.lods[l].error = chunk.lods[l - 1].error;
+			}
+			maxError = std::max(maxError, chunk.lods[l].error);
+		}
+		chunk.lods[0].data = std::move(base);
+
+		// Any two LODs differ by at most maxError in height, so skirts
+		// that deep close every crack.
+		float depth = maxError + 0.25f * spacing;
+		for (int l = 0; l < this->lodCount; l++)
+		{
+			Lod& lod = chunk.lods[l];
+			lod.triangles = lod.data.indices.size() / 3;
+			addSkirts(lod.data, box, depth, 0.25f * spacing);
+			lod.data.boundingBox = Mesh::calcBoundingBox(lod.data.vertices);
+			const BoundingBox& b = lod.data.boundingBox;
+			if (l == 0)
+			{
+				chunk.boundingBox = b;
+				continue;
+			}
+			glm::vec3 min = glm::min(glm::vec3(chunk.boundingBox.x, chunk.boundingBox.y, chunk.boundingBox.z),
+					glm::vec3(b.x, b.y, b.z));
+			glm::vec3 max = glm::max(glm::vec3(chunk.boundingBox.x + chunk.boundingBox.width,
+						chunk.boundingBox.y + chunk.boundingBox.height, chunk.boundingBox.z + chunk.boundingBox.depth),
+					glm::vec3(b.x + b.width, b.y + b.height, b.z + b.depth));
+			chunk.boundingBox = { min.x, min.y, min.z, max.x - min.x, max.y - min.y, max.z - min.z };
+		}
+		chunks.push_back(std::move(chunk));
+	}
+}
+
+TerrainChunks::~TerrainChunks() {}
+
+/**
+ * Uploads every LOD and frees the CPU copies.
+ */
+void TerrainChunks::upload(Mesh::VertexFormat format)
+{
+	for (Chunk& chunk : chunks)
+	{
+		for (Lod& lod : chunk.lods)
+		{
+			lod.mesh = std::make_unique<Mesh>(lod.data, format);
+			lod.data = MeshData();
+		}
+	}
+	uploaded = true;
+}
+
+bool TerrainChunks::isUploaded() const
+{
+	return uploaded;
+}
+
+int TerrainChunks::getLodCount() const
+{
+	return lodCount;
+}
+
+/**
+ * Draws every chunk inside frustum, or every chunk when there is none,
+ * at the coarsest LOD whose error projects to at most maxPixelError
+ * pixels. pixelScale is the viewport height divided by 2 tan(fovy / 2),
+ * so an error e at distance d covers e * pixelScale / d pixels. Assumes
+ * the shader is in use and the terrain Model's uniforms are bound.
+ */
+TerrainChunks::Stats TerrainChunks::draw(const Frustum* frustum, const glm::mat4& model,
+		const glm::vec3& cameraPosition, float pixelScale, float maxPixelError)
+{
+	Stats stats = {};
+	stats.chunkCount = chunks.size();
+
+	worldBoxes.clear();
+	for (const Chunk& chunk : chunks)
+	{
+		worldBoxes.push_back(Frustum::transform(chunk.boundingBox, model));
+	}
+	if (frustum)
+		frustum->cull(worldBoxes, visible);
+	else
+		visible.assign(chunks.size(), 1);
+
+	// Errors are measured in model space.
+	glm::mat3 linear(model);
+	float unitScale = glm::max(glm::length(linear[0]), glm::max(glm::length(linear[1]), glm::length(linear[2])));
+	for (std::size_t i = 0; i < chunks.size(); i++)
+	{
+		if (!visible[i])
+			continue;
+
+		glm::vec3 min(worldBoxes.minX[i], worldBoxes.minY[i], worldBoxes.minZ[i]);
+		glm::vec3 max(worldBoxes.maxX[i], worldBoxes.maxY[i], worldBoxes.maxZ[i]);
+		float distance = glm::length(glm::clamp(cameraPosition, min, max) - cameraPosition);
+		const Chunk& chunk = chunks[i];
+		int level = 0;
+		for (int l = lodCount - 1; l > 0; l--)
+		{
+			if (chunk.lods[l].error * unitScale * pixelScale <= maxPixelError * distance)
+			{
+				level = l;
+				break;
+			}
+		}
+
+		chunk.lods[level].mesh->draw();
+		stats.visibleChunks++;
+		stats.triangles += chunk.lods[level].triangles;
+		stats.lodChunks[level]++;
+	}
+	return stats;
+}
+
+/**
+ * Snaps chunk onto a lattice of about cellSize that spans origin to
+ * origin + size in x and z. Each lattice point keeps the vertex nearest
+ * to it with the average normal of every vertex snapped to it. error is
+ * set to the largest height difference between a vertex of chunk and
+ * the new surface above or below it.
+ */
+MeshData TerrainChunks::simplify(const MeshData& chunk, const glm::vec2& origin, const glm::vec2& size,
+		float cellSize, float& error)
+{
+	int cellsX = std::max(1, int(std::round(size.x / cellSize)));
+	int cellsZ = std::max(1, int(std::round(size.y / cellSize)));
+	glm::vec2 cell(size.x / cellsX, size.y / cellsZ);
+	int pointsX = cellsX + 1;
+	std::size_t pointCount = std::size_t(pointsX) * (cellsZ + 1);
+
+	std::vector<int> nearest(pointCount, -1);
+	std::vector<float> nearestDistance(pointCount, std::numeric_limits<float>::max());
+	std::vector<glm::vec3> normals(pointCount, glm::vec3(0));
+	for (std::size_t v = 0; v < chunk.vertices.size(); v++)
+	{
+		const Vertex& vertex = chunk.vertices[v];
+		glm::vec2 position(vertex.position.x, vertex.position.z);
+		glm::vec2 lattice = cell.x > 0 && cell.y > 0 ? (position - origin) / cell : glm::vec2(0);
+		int i = glm::clamp(int(std::round(lattice.x)), 0, cellsX);
+		int j = glm::clamp(int(std::round(lattice.y)), 0, cellsZ);
+		std::size_t point = std::size_t(j) * pointsX + i;
+		normals[point] += vertex.normal;
+		glm::vec2 offset = position - (origin + glm::vec2(i, j) * cell);
+		float distance = glm::dot(offset, offset);
+		if (distance < nearestDistance[point])
+		{
+			nearestDistance[point] = distance;
+			nearest[point] = v;
+		}
+	}
+
+	MeshData lod;
+	std::vector<int> lodIndex(pointCount, -1);
+	for (std::size_t point = 0; point < pointCount; point++)
+	{
+		if (nearest[point] < 0)
+			continue;
+		lodIndex[point] = lod.vertices.size();
+		Vertex vertex = chunk.vertices[nearest[point]];
+		if (glm::length(normals[point]) > 0)
+			vertex.normal = glm::normalize(normals[point]);
+		lod.vertices.push_back(vertex);
+	}
+	for (int j = 0; j < cellsZ; j++)
+	{
+		for (int i = 0; i < cellsX; i++)
+		{
+			int a = lodIndex[j * pointsX + i];
+			int b = lodIndex[j * pointsX + i + 1];
+			int c = lodIndex[(j + 1) * pointsX + i];
+			int d = lodIndex[(j + 1) * pointsX + i + 1];
+			if (a < 0 || b < 0 || c < 0 || d < 0)
+				continue;
+			lod.indices.insert(lod.indices.end(), { unsigned(a), unsigned(c), unsigned(d) });
+			lod.indices.insert(lod.indices.end(), { unsigned(a), unsigned(d), unsigned(b) });
+		}
+	}
+
+	// Compare every original vertex against the lattice cell it lies in,
+	// interpolating the heights of the cell's corners.
+	error = 0;
+	for (const Vertex& vertex : chunk.vertices)
+	{
+		glm::vec2 lattice = cell.x > 0 && cell.y > 0 ?
+			(glm::vec2(vertex.position.x, vertex.position.z) - origin) / cell : glm::vec2(0);
+		int i = glm::clamp(int(std::floor(lattice.x)), 0, cellsX - 1);
+		int j = glm::clamp(int(std::floor(lattice.y)), 0, cellsZ - 1);
+		int corners[4] = { lodIndex[j * pointsX + i], lodIndex[j * pointsX + i + 1],
+			lodIndex[(j + 1) * pointsX + i], lodIndex[(j + 1) * pointsX + i + 1] };
+		if (corners[0] < 0 || corners[1] < 0 || corners[2] < 0 || corners[3] < 0)
+			continue;
+		float fx = glm::clamp(lattice.x - i, 0.0f, 1.0f);
+		float fz = glm::clamp(lattice.y - j, 0.0f, 1.0f);
+		float height = glm::mix(
+				glm::mix(lod.vertices[corners[0]].position.y, lod.vertices[corners[1]].position.y, fx),
+				glm::mix(lod.vertices[corners[2]].position.y, lod.vertices[corners[3]].position.y, fx), fz);
+		error = std::max(error, std::abs(vertex.position.y - height));
+	}
+	return lod;
+}
+
+/**
+ * Hangs a strip depth units deep below every border edge of mesh, that
+ * is every edge used by one triangle. Edges are matched by position
+ * since flat shaded vertices are not shared between triangles. Edges
+ * within tolerance of the terrain's own edge get no skirt.
+ */
+void TerrainChunks::addSkirts(MeshData& mesh, const BoundingBox& terrainBox, float depth, float tolerance)
+{
+	std::map<std::tuple<float, float, float>, unsigned int> positionIds;
+	std::vector<unsigned int> positionOf(mesh.vertices.size());
+	for (std::size_t v = 0; v < mesh.vertices.size(); v++)
+	{
+		const glm::vec3& p = mesh.vertices[v].position;
+		positionOf[v] = positionIds.emplace(std::make_tuple(p.x, p.y, p.z), positionIds.size()).first->second;
+	}
+
+	auto edgeKey = [&positionOf](unsigned int a, unsigned int b) {
+		std::uint64_t pa = positionOf[a];
+		std::uint64_t pb = positionOf[b];
+		return pa < pb ? pa << 32 | pb : pb << 32 | pa;
+	};
+	std::unordered_map<std::uint64_t, int> edgeUses;
+	std::size_t indexCount = mesh.indices.size();
+	for (std::size_t i = 0; i < indexCount; i++)
+	{
+		std::size_t next = i % 3 == 2 ? i - 2 : i + 1;
+		edgeUses[edgeKey(mesh.indices[i], mesh.indices[next])]++;
+	}
+
+	auto onTerrainEdge = [&terrainBox, tolerance](const glm::vec3& a, const glm::vec3& b) {
+		float minX = terrainBox.x, maxX = terrainBox.x + terrainBox.width;
+		float minZ = terrainBox.z, maxZ = terrainBox.z + terrainBox.depth;
+		return (std::abs(a.x - minX) < tolerance && std::abs(b.x - minX) < tolerance) ||
+			(std::abs(a.x - maxX) < tolerance && std::abs(b.x - maxX) < tolerance) ||
+			(std::abs(a.z - minZ) < tolerance && std::abs(b.z - minZ) < tolerance) ||
+			(std::abs(a.z - maxZ) < tolerance && std::abs(b.z - maxZ) < tolerance);
+	};
+
+	for (std::size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int a = mesh.indices[i];
+		unsigned int b = mesh.indices[i % 3 == 2 ? i - 2 : i + 1];
+		if (edgeUses[edgeKey(a, b)] != 1 ||
+				onTerrainEdge(mesh.vertices[a].position, mesh.vertices[b].position))
+			continue;
+
+		unsigned int lowA = mesh.vertices.size();
+		unsigned int lowB = lowA + 1;
+		Vertex bottomA = mesh.vertices[a];
+		Vertex bottomB = mesh.vertices[b];
+		bottomA.position.y -= depth;
+		bottomB.position.y -= depth;
+		mesh.vertices.push_back(bottomA);
+		mesh.vertices.push_back(bottomB);
+		mesh.indices.insert(mesh.indices.end(), { a, b, lowB });
+		mesh.indices.insert(mesh.indices.end(), { a, lowB, lowA });
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "Frustum.h"
+
+/**
+ * A heightfield mesh split into a square grid of chunks, each with a few
+ * levels of detail. LOD 0 holds the chunk's original triangles. Every
+ * further LOD halves the resolution by snapping the chunk onto a coarser
+ * lattice: the vertex nearest each lattice point is kept and the lattice
+ * is triangulated again. Neighbouring chunks at the same LOD share their
+ * border vertices. At different LODs the gaps are hidden by skirts, strips
+ * hanging down from every chunk border that is not the terrain's edge.
+ *
+ * Building needs no GL context and may run on a worker thread. upload()
+ * and draw() must run on the thread that owns the context.
+ */
+class TerrainChunks
+{
+	public:
+		static const int MAX_LOD_COUNT = 4;
+
+		struct Stats
+		{
+			unsigned int chunkCount;
+			unsigned int visibleChunks;
+			std::size_t triangles;
+			unsigned int lodChunks[MAX_LOD_COUNT];	// Visible chunks per LOD.
+		};
+
+		TerrainChunks(const MeshData& terrain, int chunksPerSide = 8, int lodCount = 3);
+		~TerrainChunks();
+		void upload(Mesh::VertexFormat format = Mesh::FULL);
+		bool isUploaded() const;
+		int getLodCount() const;
+		Stats draw(const Frustum* frustum, const glm::mat4& model, const glm::vec3& cameraPosition,
+				float pixelScale, float maxPixelError);
+
+	private:
+		struct Lod
+		{
+			MeshData data;				// Freed by upload().
+			std::unique_ptr<Mesh> mesh;
+			float error;				// Largest height difference from LOD 0.
+			std::size_t triangles;		// Without the skirts.
+		};
+
+		struct Chunk
+		{
+			BoundingBox boundingBox;	// Covers every LOD and skirt.
+			std::vector<Lod> lods;
+		};
+
+		std::vector<Chunk> chunks;
+		int lodCount;
+		bool uploaded;
+		// Reused by draw().
+		BoxList worldBoxes;
+		std::vector<unsigned char> visible;
+
+		static MeshData simplify(const MeshData& chunk, const glm::vec2& origin, const glm::vec2& size,
+				float cellSize, float& error);
+		static void addSkirts(MeshData& mesh, const BoundingBox& terrainBox, float depth, float tolerance);
+};
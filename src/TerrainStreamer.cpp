@@ -0,0 +1,350 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <set>
+
+#include "TerrainStreamer.h"
+
+namespace
+{
+	// How far ahead of a moving camera chunks are requested.
+	const float PREFETCH_SECONDS = 2.0f;
+	const std::size_t VERTICES_PER_CHUNK = (TerrainStreamer::CHUNK_QUADS + 1) * (TerrainStreamer::CHUNK_QUADS + 1);
+}
+
+/**
+ * pool generates the chunks. memoryCap is the size of the vertex buffer
+ * that holds them, in bytes.
+ */
+TerrainStreamer::TerrainStreamer(const Noise& noise, ThreadPool& pool, std::size_t memoryCap,
+		float chunkSize, float radius) :
+	noise(noise), pool(pool), memoryCap(memoryCap), chunkSize(chunkSize), radius(radius), settings(),
+	generation(0), frame(0), indexCount(0), stats()
+{
+	createPool();
+}
+
+/**
+ * Workers still generating write into builds, so wait for them.
+ */
+TerrainStreamer::~TerrainStreamer()
+{
+	for (auto& build : builds)
+	{
+		build->done.wait();
+	}
+}
+
+/**
+ * Chunks made with other settings are dropped and generated again.
+ */
+void TerrainStreamer::setSettings(const ProceduralTerrain::Settings& newSettings)
+{
+	if (settings.height == newSettings.height && settings.frequency == newSettings.frequency &&
+			settings.persistence == newSettings.persistence && settings.octaves == newSettings.octaves &&
+			settings.textureScale == newSettings.textureScale)
+		return;
+	settings = newSettings;
+	generation++;
+	clear();
+}
+
+/**
+ * Reallocates the pool for the new cap. Every resident chunk is dropped.
+ */
+void TerrainStreamer::setMemoryCap(std::size_t newMemoryCap)
+{
+	if (newMemoryCap == memoryCap)
+		return;
+	memoryCap = newMemoryCap;
+	createPool();
+}
+
+/**
+ * Uploads finished chunks until budgetSeconds have passed and requests
+ * the chunks missing around the camera. velocity and front say where the
+ * camera is heading. Call once a frame on the thread that owns the GL
+ * context.
+ */
+void TerrainStreamer::update(const glm::vec3& cameraPosition, const glm::vec3& velocity, const glm::vec3& front,
+		float budgetSeconds)
+{
+	frame++;
+	stats.uploaded = 0;
+	glm::vec2 camera(cameraPosition.x, cameraPosition.z);
+	glm::vec2 heading(velocity.x, velocity.z);
+	glm::vec2 facing(front.x, front.z);
+	glm::vec2 ahead = camera;
+	if (glm::length(heading) > 0.01f)
+		ahead += heading * PREFETCH_SECONDS;
+	else if (glm::length(facing) > 0.01f)
+		ahead += glm::normalize(facing) * chunkSize * 0.5f;
+
+	// Chunks around the camera are the last to be evicted.
+	for (const auto& entry : resident)
+	{
+		if (distance(entry.first, camera) <= radius)
+			slots[entry.second].lastUsed = frame;
+	}
+
+	// Upload finished chunks nearest to where the camera is going first.
+	std::vector<Build*> ready;
+	for (auto& build : builds)
+	{
+		if (build->done.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			ready.push_back(build.get());
+	}
+	std::sort(ready.begin(), ready.end(), [this, &ahead](const Build* a, const Build* b) {
+		return distance(a->coord, ahead) < distance(b->coord, ahead);
+	});
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point deadline = Clock::now() +
+		std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(budgetSeconds));
+	std::set<const Build*> finished;
+	for (Build* build : ready)
+	{
+		bool wanted = distance(build->coord, camera) <= radius || distance(build->coord, ahead) <= radius;
+		if (build->generation != generation || !wanted)
+		{
+			finished.insert(build);
+			continue;
+		}
+		if (stats.uploaded > 0 && Clock::now() >= deadline)
+			continue;
+		if (upload(*build))
+		{
+			finished.insert(build);
+			stats.uploaded++;
+		}
+	}
+	builds.erase(std::remove_if(builds.begin(), builds.end(), [&finished](const std::unique_ptr<Build>& build) {
+		return finished.count(build.get()) > 0;
+	}), builds.end());
+
+	// Request what is missing within radius of the camera and of where it
+	// is heading, nearest to the latter first. A few requests at a time
+	// keep the queue short, so a turning camera is followed quickly.
+	std::size_t maxBuilds = 2 * std::max(pool.getThreadCount(), 1u);
+	if (builds.size() < maxBuilds)
+	{
+		std::set<Coord> building;
+		for (const auto& build : builds)
+		{
+			building.insert(build->coord);
+		}
+
+		std::vector<std::pair<float, Coord>> candidates;
+		glm::ivec2 first = glm::ivec2(glm::floor((glm::min(camera, ahead) - radius) / chunkSize));
+		glm::ivec2 last = glm::ivec2(glm::floor((glm::max(camera, ahead) + radius) / chunkSize));
+		for (int z = first.y; z <= last.y; z++)
+		{
+			for (int x = first.x; x <= last.x; x++)
+			{
+				Coord coord(x, z);
+				if (distance(coord, camera) > radius && distance(coord, ahead) > radius)
+					continue;
+				if (resident.count(coord) || building.count(coord))
+					continue;
+				candidates.push_back({ distance(coord, ahead), coord });
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+
+		for (std::size_t i = 0; i < candidates.size() && builds.size() < maxBuilds; i++)
+		{
+			auto build = std::make_unique<Build>();
+			build->coord = candidates[i].second;
+			build->generation = generation;
+			Build* target = build.get();
+			build->done = pool.submit([this, target, buildSettings = settings]() {
+				generate(*target, buildSettings);
+			});
+			builds.push_back(std::move(build));
+		}
+	}
+
+	stats.resident = resident.size();
+	stats.pending = builds.size();
+}
+
+/**
+ * Draws every resident chunk inside frustum, or every one when there is
+ * none. Assumes a STREAMED_TERRAIN shader is in use.
+ */
+void TerrainStreamer::draw(const Shader& shader, const Frustum* frustum)
+{
+	stats.drawn = 0;
+	auto found = textureScaleUniforms.find(&shader);
+	if (found == textureScaleUniforms.end())
+		found = textureScaleUniforms.emplace(&shader, shader.getUniform<float>("terrainTextureScale")).first;
+	shader.setUniform(found->second, settings.textureScale);
+	// Chunks are plain Vertex data in world space.
+	glVertexAttrib4f(Mesh::DEQUANTIZE_LOCATION, 1, 1, 1, 0);
+	glVertexAttrib4f(Mesh::DEQUANTIZE_LOCATION + 1, 0, 0, 0, 0);
+	vertexArray->bind();
+	for (std::size_t i = 0; i < slots.size(); i++)
+	{
+		if (!slots[i].used || (frustum && !frustum->intersects(slots[i].boundingBox)))
+			continue;
+		glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, i * VERTICES_PER_CHUNK);
+		stats.drawn++;
+	}
+	glBindVertexArray(0);
+}
+
+const TerrainStreamer::Stats& TerrainStreamer::getStats() const
+{
+	return stats;
+}
+
+std::size_t TerrainStreamer::getMemoryCap() const
+{
+	return memoryCap;
+}
+
+/**
+ * Allocates as many chunk slots as fit in memoryCap, at least one. Every
+ * chunk has the same grid, so they share one index buffer and a chunk is
+ * drawn with its slot's base vertex.
+ */
+void TerrainStreamer::createPool()
+{
+	std::vector<unsigned int> indices;
+	for (int z = 0; z < CHUNK_QUADS; z++)
+	{
+		for (int x = 0; x < CHUNK_QUADS; x++)
+		{
+			unsigned int a = z * (CHUNK_QUADS + 1) + x;
+			unsigned int b = a + 1;
+			unsigned int c = a + CHUNK_QUADS + 1;
+			unsigned int d = c + 1;
+			indices.insert(indices.end(), { a, c, d, a, d, b });
+		}
+	}
+	indexCount = indices.size();
+
+	std::size_t chunkBytes = VERTICES_PER_CHUNK * sizeof(Vertex);
+	std::size_t slotCount = std::max<std::size_t>(memoryCap / chunkBytes, 1);
+	vertexArray = std::make_unique<VertexArray>(nullptr, slotCount * VERTICES_PER_CHUNK,
+			indices.data(), indices.size());
+	slots.assign(slotCount, Slot());
+	resident.clear();
+	stats.slots = slotCount;
+	stats.gpuSize = slotCount * chunkBytes + indices.size() * sizeof(unsigned int);
+}
+
+/**
+ * Forgets every resident chunk. Their slots are overwritten later.
+ */
+void TerrainStreamer::clear()
+{
+	for (Slot& slot : slots)
+	{
+		slot.used = false;
+	}
+	resident.clear();
+}
+
+/**
+ * Copies build into a free slot, or into the least recently used one
+ * that was not wanted this frame. Returns false when every slot holds a
+ * chunk near the camera.
+ */
+bool TerrainStreamer::upload(Build& build)
+{
+	std::size_t target = slots.size();
+	for (std::size_t i = 0; i < slots.size(); i++)
+	{
+		if (!slots[i].used)
+		{
+			target = i;
+			break;
+		}
+		if (slots[i].lastUsed < frame && (target == slots.size() || slots[i].lastUsed < slots[target].lastUsed))
+			target = i;
+	}
+	if (target == slots.size())
+		return false;
+
+	Slot& slot = slots[target];
+	if (slot.used)
+	{
+		resident.erase(slot.coord);
+		stats.evicted++;
+	}
+	vertexArray->setVertices(target * VERTICES_PER_CHUNK, build.vertices.data(), build.vertices.size());
+	slot.coord = build.coord;
+	slot.used = true;
+	slot.lastUsed = frame;
+	slot.boundingBox = build.boundingBox;
+	resident[build.coord] = target;
+	return true;
+}
+
+/**
+ * Evaluates the fBm of vertex.glsl's terrainHeight() on the chunk's grid
+ * with the batch noise functions, one octave over the whole grid at a
+ * time. Grid positions come from whole numbers, so neighbouring chunks
+ * agree exactly on their shared edge. Runs on a worker thread.
+ */
+void TerrainStreamer::generate(Build& build, const ProceduralTerrain::Settings& buildSettings) const
+{
+	const int side = CHUNK_QUADS + 1;
+	const float spacing = chunkSize / CHUNK_QUADS;
+	std::vector<float> worldX(VERTICES_PER_CHUNK), worldZ(VERTICES_PER_CHUNK);
+	for (int j = 0; j < side; j++)
+	{
+		for (int i = 0; i < side; i++)
+		{
+			worldX[j * side + i] = float(build.coord.first * CHUNK_QUADS + i) * spacing;
+			worldZ[j * side + i] = float(build.coord.second * CHUNK_QUADS + j) * spacing;
+		}
+	}
+
+	std::vector<float> x(VERTICES_PER_CHUNK), y(VERTICES_PER_CHUNK, 0.5f), z(VERTICES_PER_CHUNK);
+	std::vector<float> value(VERTICES_PER_CHUNK), dx(VERTICES_PER_CHUNK), dy(VERTICES_PER_CHUNK),
+		dz(VERTICES_PER_CHUNK);
+	std::vector<float> height(VERTICES_PER_CHUNK, 0), slopeX(VERTICES_PER_CHUNK, 0),
+		slopeZ(VERTICES_PER_CHUNK, 0);
+	float amplitude = buildSettings.height;
+	float frequency = buildSettings.frequency;
+	for (int octave = 0; octave < buildSettings.octaves; octave++)
+	{
+		for (std::size_t k = 0; k < VERTICES_PER_CHUNK; k++)
+		{
+			x[k] = worldX[k] * frequency;
+			z[k] = worldZ[k] * frequency;
+		}
+		noise.noise(x.data(), y.data(), z.data(), value.data(), dx.data(), dy.data(), dz.data(),
+				VERTICES_PER_CHUNK);
+		for (std::size_t k = 0; k < VERTICES_PER_CHUNK; k++)
+		{
+			height[k] += (value[k] - 0.5f) * amplitude;
+			slopeX[k] += dx[k] * frequency * amplitude;
+			slopeZ[k] += dz[k] * frequency * amplitude;
+		}
+		amplitude *= buildSettings.persistence;
+		frequency *= 2;
+	}
+
+	build.vertices.resize(VERTICES_PER_CHUNK);
+	for (std::size_t k = 0; k < VERTICES_PER_CHUNK; k++)
+	{
+		Vertex& vertex = build.vertices[k];
+		vertex.position = glm::vec3(worldX[k], height[k], worldZ[k]);
+		vertex.normal = glm::normalize(glm::vec3(-slopeX[k], 1, -slopeZ[k]));
+		vertex.texture = glm::vec2(float(k % side), float(k / side)) / float(CHUNK_QUADS);
+	}
+	build.boundingBox = Mesh::calcBoundingBox(build.vertices);
+}
+
+/**
+ * Distance on the xz plane from point to the nearest point of the chunk.
+ */
+float TerrainStreamer::distance(const Coord& coord, const glm::vec2& point) const
+{
+	glm::vec2 corner = glm::vec2(coord.first, coord.second) * chunkSize;
+	glm::vec2 nearest = glm::clamp(point, corner, corner + chunkSize);
+	return glm::length(point - nearest);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <future>
+#include <utility>
+#include <glm/glm.hpp>
+#include <noise/Noise.h>
+
+#include "VertexArray.h"
+#include "Shader.h"
+#include "Frustum.h"
+#include "ThreadPool.h"
+#include "ProceduralTerrain.h"
+
+/**
+ * Terrain that follows the camera anywhere, made of square heightfield
+ * chunks generated on worker threads with the CPU noise library. The
+ * heights are the same fBm ProceduralTerrain evaluates in vertex.glsl.
+ *
+ * Finished chunks are uploaded by update() under a time budget into a
+ * pool of equal slots in one vertex buffer, sized to fit a memory cap.
+ * When the pool is full the least recently used chunk is evicted.
+ * Chunks are requested nearest first from where the camera will be
+ * shortly, so chunks ahead of a moving camera are ready before it gets
+ * there.
+ */
+class TerrainStreamer
+{
+	public:
+		static const int CHUNK_QUADS = 32;	// Quads per side of a chunk.
+
+		struct Stats
+		{
+			std::size_t resident;	// Chunks in the pool.
+			std::size_t slots;		// Chunks the pool can hold.
+			std::size_t pending;	// Chunks being generated or waiting for upload.
+			unsigned int uploaded;	// Chunks uploaded by the last update().
+			unsigned int evicted;	// Chunks evicted since the start.
+			unsigned int drawn;		// Chunks drawn by the last draw().
+			std::size_t gpuSize;	// Bytes of the pool.
+		};
+
+		TerrainStreamer(const Noise& noise, ThreadPool& pool, std::size_t memoryCap,
+				float chunkSize = 16.0f, float radius = 64.0f);
+		~TerrainStreamer();
+		void setSettings(const ProceduralTerrain::Settings& settings);
+		void setMemoryCap(std::size_t memoryCap);
+		void update(const glm::vec3& cameraPosition, const glm::vec3& velocity, const glm::vec3& front,
+				float budgetSeconds);
+		void draw(const Shader& shader, const Frustum* frustum);
+		const Stats& getStats() const;
+		std::size_t getMemoryCap() const;
+
+	private:
+		typedef std::pair<int, int> Coord;
+
+		// A chunk being generated on a worker, then waiting for a slot.
+		struct Build
+		{
+			Coord coord;
+			unsigned int generation;
+			std::vector<Vertex> vertices;	// Set by the worker.
+			BoundingBox boundingBox;		// Set by the worker.
+			std::future<void> done;
+		};
+
+		struct Slot
+		{
+			Coord coord;
+			bool used;
+			unsigned long lastUsed;		// Frame the chunk was last wanted.
+			BoundingBox boundingBox;
+		};
+
+		const Noise& noise;
+		ThreadPool& pool;
+		std::size_t memoryCap;
+		float chunkSize;
+		float radius;				// Chunks within radius of the camera are wanted.
+		ProceduralTerrain::Settings settings;
+		unsigned int generation;	// Bumped when the settings change.
+		unsigned long frame;
+		std::unique_ptr<VertexArray> vertexArray;
+		std::vector<Slot> slots;
+		std::map<Coord, std::size_t> resident;	// Chunk to slot.
+		std::vector<std::unique_ptr<Build>> builds;
+		std::size_t indexCount;
+		Stats stats;
+		// terrainTextureScale in each program draw() was given, resolved on
+		// its first draw. ShaderCache keeps its programs while it exists.
+		std::unordered_map<const Shader*, Uniform<float>> textureScaleUniforms;
+
+		void createPool();
+		void clear();
+		bool upload(Build& build);
+		void generate(Build& build, const ProceduralTerrain::Settings& settings) const;
+		float distance(const Coord& coord, const glm::vec2& point) const;
+};
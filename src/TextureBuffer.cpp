@@ -0,0 +1,43 @@
+#include "TextureBuffer.h"
+
+TextureBuffer::TextureBuffer(GLenum internalFormat) :
+	internalFormat(internalFormat)
+{
+	glGenBuffers(1, &bufferId);
+	glGenTextures(1, &id);
+}
+
+TextureBuffer::~TextureBuffer()
+{
+	glDeleteTextures(1, &id);
+	glDeleteBuffers(1, &bufferId);
+}
+
+unsigned int TextureBuffer::getId() const
+{
+	return id;
+}
+
+/**
+ * Replaces the contents of the buffer. size is in bytes.
+ */
+void TextureBuffer::setData(const void* data, std::size_t size)
+{
+	glBindBuffer(GL_TEXTURE_BUFFER, bufferId);
+	glBufferData(GL_TEXTURE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glBindTexture(GL_TEXTURE_BUFFER, id);
+	glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, bufferId);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+/**
+ *	Sets the current active texture to the one specified in the parameter,
+ *	and then binds the buffer texture.
+ */
+void TextureBuffer::bind(GLenum texture) const
+{
+	glActiveTexture(texture);
+	glBindTexture(GL_TEXTURE_BUFFER, id);
+}
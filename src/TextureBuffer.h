@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+
+/**
+ * A buffer texture, read in shaders with texelFetch() on a samplerBuffer.
+ * Used for per model tables that are too large or too variable in size
+ * for uniform arrays.
+ */
+
+class TextureBuffer
+{
+	public:
+		TextureBuffer(GLenum internalFormat);
+		~TextureBuffer();
+		unsigned int getId() const;
+		void setData(const void* data, std::size_t size);
+		void bind(GLenum texture) const;
+
+	private:
+		unsigned int id;
+		unsigned int bufferId;
+		GLenum internalFormat;
+};
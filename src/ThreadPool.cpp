@@ -0,0 +1,95 @@
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount) :
+	stopping(false)
+{
+	threadCount = std::max(threadCount, 1u);
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+/**
+ * Finishes every job already queued before joining the workers.
+ */
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+unsigned int ThreadPool::getThreadCount() const
+{
+	return workers.size();
+}
+
+/**
+ * Queues a job. The returned future becomes ready once it has run.
+ */
+std::future<void> ThreadPool::submit(std::function<void()> job)
+{
+	std::packaged_task<void()> task(std::move(job));
+	std::future<void> future = task.get_future();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push(std::move(task));
+	}
+	condition.notify_one();
+	return future;
+}
+
+/**
+ * Splits [0, count) into ranges of at least grain items, runs body on
+ * each range across the workers and waits for all of them. The calling
+ * thread runs the first range itself.
+ */
+void ThreadPool::parallelFor(std::size_t count, std::size_t grain,
+		const std::function<void(std::size_t begin, std::size_t end)>& body)
+{
+	if (count == 0)
+		return;
+
+	grain = std::max<std::size_t>(grain, 1);
+	std::size_t chunks = std::min<std::size_t>((count + grain - 1) / grain, workers.size() + 1);
+	std::size_t chunkSize = (count + chunks - 1) / chunks;
+
+	std::vector<std::future<void>> pending;
+	for (std::size_t begin = chunkSize; begin < count; begin += chunkSize)
+	{
+		std::size_t end = std::min(begin + chunkSize, count);
+		pending.push_back(submit([&body, begin, end] { body(begin, end); }));
+	}
+	body(0, std::min(chunkSize, count));
+
+	for (auto& future : pending)
+	{
+		future.get();
+	}
+}
+
+void ThreadPool::work()
+{
+	while (true)
+	{
+		std::packaged_task<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (jobs.empty())
+				return;
+			task = std::move(jobs.front());
+			jobs.pop();
+		}
+		task();
+	}
+}
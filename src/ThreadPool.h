@@ -0,0 +1,32 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <queue>
+#include <vector>
+
+/*
+ * A fixed set of worker threads that run queued jobs in order.
+ */
+class ThreadPool
+{
+	public:
+		ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+		~ThreadPool();
+		unsigned int getThreadCount() const;
+		std::future<void> submit(std::function<void()> job);
+		void parallelFor(std::size_t count, std::size_t grain,
+				const std::function<void(std::size_t begin, std::size_t end)>& body);
+
+	private:
+		std::vector<std::thread> workers;
+		std::queue<std::packaged_task<void()>> jobs;
+		std::mutex mutex;
+		std::condition_variable condition;
+		bool stopping;
+
+		void work();
+};
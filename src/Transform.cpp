@@ -0,0 +1,114 @@
+#include <glm/gtx/euler_angles.hpp>
+
+#include "Transform.h"
+
+Transform::Transform() :
+	position(0), rotation(1, 0, 0, 0), scaleFactor(1), matrix(1.0f), version(0), dirty(false)
+{
+}
+
+void Transform::setPosition(const glm::vec3& newPosition)
+{
+	if (newPosition == position)
+		return;
+	position = newPosition;
+	dirty = true;
+}
+
+void Transform::setRotation(const glm::quat& newRotation)
+{
+	if (newRotation == rotation)
+		return;
+	rotation = newRotation;
+	dirty = true;
+}
+
+void Transform::setScale(float newScale)
+{
+	if (newScale == scaleFactor)
+		return;
+	scaleFactor = newScale;
+	dirty = true;
+}
+
+/**
+ * Moves by offset along the object's own, scaled axes.
+ */
+void Transform::translate(const glm::vec3& offset)
+{
+	if (offset == glm::vec3(0))
+		return;
+	position += rotation * (scaleFactor * offset);
+	dirty = true;
+}
+
+/**
+ * Rotates about the object's own x, y and z axes, in that order, by
+ * angles in radians. Remember to use the right-hand rule.
+ */
+void Transform::rotate(const glm::vec3& angles)
+{
+	if (angles == glm::vec3(0))
+		return;
+	rotation = glm::normalize(rotation * glm::quat_cast(glm::eulerAngleXYZ(angles.x, angles.y, angles.z)));
+	dirty = true;
+}
+
+void Transform::scale(float factor)
+{
+	if (factor == 1)
+		return;
+	scaleFactor *= factor;
+	dirty = true;
+}
+
+/**
+ * Recomposes the matrix if anything changed since the last call.
+ * Returns whether it did.
+ */
+bool Transform::update()
+{
+	if (!dirty)
+		return false;
+	matrix = glm::mat4_cast(rotation);
+	matrix[0] *= scaleFactor;
+	matrix[1] *= scaleFactor;
+	matrix[2] *= scaleFactor;
+	matrix[3] = glm::vec4(position, 1);
+	version++;
+	dirty = false;
+	return true;
+}
+
+const glm::vec3& Transform::getPosition() const
+{
+	return position;
+}
+
+const glm::quat& Transform::getRotation() const
+{
+	return rotation;
+}
+
+float Transform::getScale() const
+{
+	return scaleFactor;
+}
+
+/**
+ * The matrix as of the last update().
+ */
+const glm::mat4& Transform::getMatrix() const
+{
+	return matrix;
+}
+
+unsigned int Transform::getVersion() const
+{
+	return version;
+}
+
+bool Transform::isDirty() const
+{
+	return dirty;
+}
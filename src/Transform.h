@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+/**
+ * Position, rotation and uniform scale of an object, composed into a
+ * model matrix translate * rotate * scale. The matrix is cached and only
+ * recomputed by update() after something changed. getVersion() goes up
+ * with every recompute, so state derived from the matrix, like a world
+ * space box, can tell when it is stale.
+ *
+ * translate(), rotate() and scale() act in the object's own space, as if
+ * the matrix was post-multiplied by them. The scale is uniform so that
+ * stays representable as TRS.
+ */
+class Transform
+{
+	public:
+		Transform();
+		void setPosition(const glm::vec3& position);
+		void setRotation(const glm::quat& rotation);
+		void setScale(float scale);
+		void translate(const glm::vec3& offset);
+		void rotate(const glm::vec3& angles);
+		void scale(float factor);
+		bool update();
+		const glm::vec3& getPosition() const;
+		const glm::quat& getRotation() const;
+		float getScale() const;
+		const glm::mat4& getMatrix() const;
+		unsigned int getVersion() const;
+		bool isDirty() const;
+
+	private:
+		glm::vec3 position;
+		glm::quat rotation;
+		float scaleFactor;
+		glm::mat4 matrix;		// Composed by the last update().
+		unsigned int version;	// Bumped by every recompute.
+		bool dirty;
+};
@@ -0,0 +1,114 @@
+#include <cmath>
+
+#include "TransformBatch.h"
+
+void TransformList::clear()
+{
+	std::vector<float>* arrays[] = { &positionX, &positionY, &positionZ,
+		&rotationX, &rotationY, &rotationZ, &rotationW, &scale };
+	for (std::vector<float>* array : arrays)
+	{
+		array->clear();
+	}
+}
+
+void TransformList::push_back(const Transform& transform)
+{
+	const glm::vec3& position = transform.getPosition();
+	const glm::quat& rotation = transform.getRotation();
+	positionX.push_back(position.x);
+	positionY.push_back(position.y);
+	positionZ.push_back(position.z);
+	rotationX.push_back(rotation.x);
+	rotationY.push_back(rotation.y);
+	rotationZ.push_back(rotation.z);
+	rotationW.push_back(rotation.w);
+	scale.push_back(transform.getScale());
+}
+
+std::size_t TransformList::size() const
+{
+	return positionX.size();
+}
+
+bool TransformBatch::hasAvx2()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	static bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Writes the translate * rotate * scale matrix of every transform to
+ * matrices, which must hold transforms.size() of them.
+ */
+void TransformBatch::compose(const TransformList& transforms, glm::mat4* matrices)
+{
+	if (hasAvx2())
+		composeAvx2(transforms, matrices);
+	else
+		composeScalar(transforms, matrices);
+}
+
+/**
+ * Sets worldBoxes to the world space box around each of the count boxes
+ * placed by its matrix.
+ */
+void TransformBatch::transformBoxes(const glm::mat4* matrices, const BoundingBox* boxes, std::size_t count,
+		BoxList& worldBoxes)
+{
+	worldBoxes.resize(count);
+	if (hasAvx2())
+		transformBoxesAvx2(matrices, boxes, count, worldBoxes);
+	else
+		transformBoxesScalar(matrices, boxes, count, worldBoxes);
+}
+
+/**
+ * The rotation part follows glm::mat3_cast().
+ */
+void TransformBatch::composeScalar(const TransformList& transforms, glm::mat4* matrices, std::size_t first)
+{
+	for (std::size_t i = first; i < transforms.size(); i++)
+	{
+		float x = transforms.rotationX[i], y = transforms.rotationY[i];
+		float z = transforms.rotationZ[i], w = transforms.rotationW[i];
+		float s = transforms.scale[i];
+		float xx = x * x, yy = y * y, zz = z * z;
+		float xy = x * y, xz = x * z, yz = y * z;
+		float wx = w * x, wy = w * y, wz = w * z;
+
+		glm::mat4& m = matrices[i];
+		m[0] = glm::vec4((1 - 2 * (yy + zz)) * s, 2 * (xy + wz) * s, 2 * (xz - wy) * s, 0);
+		m[1] = glm::vec4(2 * (xy - wz) * s, (1 - 2 * (xx + zz)) * s, 2 * (yz + wx) * s, 0);
+		m[2] = glm::vec4(2 * (xz + wy) * s, 2 * (yz - wx) * s, (1 - 2 * (xx + yy)) * s, 0);
+		m[3] = glm::vec4(transforms.positionX[i], transforms.positionY[i], transforms.positionZ[i], 1);
+	}
+}
+
+/**
+ * Arvo's method, as in Frustum::transform(), writing min and max.
+ */
+void TransformBatch::transformBoxesScalar(const glm::mat4* matrices, const BoundingBox* boxes, std::size_t count,
+		BoxList& worldBoxes, std::size_t first)
+{
+	float* min[] = { worldBoxes.minX.data(), worldBoxes.minY.data(), worldBoxes.minZ.data() };
+	float* max[] = { worldBoxes.maxX.data(), worldBoxes.maxY.data(), worldBoxes.maxZ.data() };
+	for (std::size_t i = first; i < count; i++)
+	{
+		const glm::mat4& m = matrices[i];
+		const BoundingBox& box = boxes[i];
+		glm::vec3 half = 0.5f * glm::vec3(box.width, box.height, box.depth);
+		glm::vec3 center = glm::vec3(box.x, box.y, box.z) + half;
+		for (int r = 0; r < 3; r++)
+		{
+			float worldCenter = (m[0][r] * center.x + m[1][r] * center.y) + (m[2][r] * center.z + m[3][r]);
+			float worldHalf = std::abs(m[0][r]) * half.x + std::abs(m[1][r]) * half.y + std::abs(m[2][r]) * half.z;
+			min[r][i] = worldCenter - worldHalf;
+			max[r][i] = worldCenter + worldHalf;
+		}
+	}
+}
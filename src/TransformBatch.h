@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Transform.h"
+#include "Frustum.h"
+
+/**
+ * Positions, rotations and scales of many Transforms as separate arrays
+ * (SoA), so TransformBatch can load eight of each with one instruction.
+ */
+struct TransformList
+{
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scale;
+
+	void clear();
+	void push_back(const Transform& transform);
+	std::size_t size() const;
+};
+
+/**
+ * Batch versions of Transform::update() and Frustum::transform() for
+ * many objects at once. The AVX2 kernels work on eight objects per
+ * instruction, with each matrix element in its own register, and are
+ * used when the CPU supports AVX2. The scalar kernels do the same work
+ * one object at a time and finish the tail that does not fill a
+ * register. Both round like the glm path apart from the order of a few
+ * additions.
+ */
+namespace TransformBatch
+{
+	bool hasAvx2();
+	void compose(const TransformList& transforms, glm::mat4* matrices);
+	void transformBoxes(const glm::mat4* matrices, const BoundingBox* boxes, std::size_t count,
+			BoxList& worldBoxes);
+
+	// The kernels behind the functions above. They process objects first
+	// and up, and write into worldBoxes in place, so it must already
+	// hold count boxes.
+	void composeScalar(const TransformList& transforms, glm::mat4* matrices, std::size_t first = 0);
+	void composeAvx2(const TransformList& transforms, glm::mat4* matrices);
+	void transformBoxesScalar(const glm::mat4* matrices, const BoundingBox* boxes, std::size_t count,
+			BoxList& worldBoxes, std::size_t first = 0);
+	void transformBoxesAvx2(const glm::mat4* matrices, const BoundingBox* boxes, std::size_t count,
+			BoxList& worldBoxes);
+}
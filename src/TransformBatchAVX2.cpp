@@ -0,0 +1,167 @@
+/*
+ * Eight lane TransformBatch kernels. This file is compiled with -mavx2
+ * and is only called after TransformBatch::hasAvx2() said yes. FMA is
+ * left off so every lane rounds like the scalar kernels.
+ */
+
+#include "TransformBatch.h"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace
+{
+	/**
+	 * Transposes eight registers of eight floats in place, so register i
+	 * ends up holding lane i of every input register.
+	 */
+	inline void transpose8(__m256 r[8])
+	{
+		__m256 t[8], s[8];
+		for (int i = 0; i < 8; i += 2)
+		{
+			t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+			t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+		}
+		for (int i = 0; i < 8; i += 4)
+		{
+			s[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+			s[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+			s[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+			s[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			r[i] = _mm256_permute2f128_ps(s[i], s[i + 4], 0x20);
+			r[i + 4] = _mm256_permute2f128_ps(s[i], s[i + 4], 0x31);
+		}
+	}
+
+	inline __m256 absolute(__m256 x)
+	{
+		return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+	}
+}
+
+/**
+ * Builds the sixteen elements of eight matrices in sixteen registers,
+ * one element per register and one matrix per lane, then transposes
+ * them into eight column major matrices.
+ */
+void TransformBatch::composeAvx2(const TransformList& transforms, glm::mat4* matrices)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1);
+	const __m256 two = _mm256_set1_ps(2);
+	std::size_t count = transforms.size();
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(transforms.rotationX.data() + i);
+		__m256 y = _mm256_loadu_ps(transforms.rotationY.data() + i);
+		__m256 z = _mm256_loadu_ps(transforms.rotationZ.data() + i);
+		__m256 w = _mm256_loadu_ps(transforms.rotationW.data() + i);
+		__m256 s = _mm256_loadu_ps(transforms.scale.data() + i);
+		__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+		__m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+		__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+		// Columns 0 and 1, then columns 2 and 3.
+		__m256 low[8] = {
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), s),
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), s),
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), s),
+			zero,
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), s),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), s),
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), s),
+			zero };
+		__m256 high[8] = {
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), s),
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), s),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), s),
+			zero,
+			_mm256_loadu_ps(transforms.positionX.data() + i),
+			_mm256_loadu_ps(transforms.positionY.data() + i),
+			_mm256_loadu_ps(transforms.positionZ.data() + i),
+			one };
+		transpose8(low);
+		transpose8(high);
+		for (int lane = 0; lane < 8; lane++)
+		{
+			float* m = &matrices[i + lane][0][0];
+			_mm256_storeu_ps(m, low[lane]);
+			_mm256_storeu_ps(m + 8, high[lane]);
+		}
+	}
+	composeScalar(transforms, matrices, i);
+}
+
+/**
+ * Loads eight matrices as two halves of eight floats each and transposes
+ * them, so each element is one register across the eight objects. The
+ * boxes are gathered a field at a time.
+ */
+void TransformBatch::transformBoxesAvx2(const glm::mat4* matrices, const BoundingBox* boxes, std::size_t count,
+		BoxList& worldBoxes)
+{
+	const int fields = sizeof(BoundingBox) / sizeof(float);
+	const __m256i boxIndex = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+			_mm256_set1_epi32(fields));
+	const __m256 oneHalf = _mm256_set1_ps(0.5f);
+	float* min[] = { worldBoxes.minX.data(), worldBoxes.minY.data(), worldBoxes.minZ.data() };
+	float* max[] = { worldBoxes.maxX.data(), worldBoxes.maxY.data(), worldBoxes.maxZ.data() };
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 low[8], high[8];
+		for (int lane = 0; lane < 8; lane++)
+		{
+			const float* m = &matrices[i + lane][0][0];
+			low[lane] = _mm256_loadu_ps(m);
+			high[lane] = _mm256_loadu_ps(m + 8);
+		}
+		transpose8(low);
+		transpose8(high);
+		// Element [c][r] is in low[c * 4 + r] for columns 0 and 1 and in
+		// high[(c - 2) * 4 + r] for columns 2 and 3.
+		const __m256* column[4] = { low, low + 4, high, high + 4 };
+
+		const float* box = &boxes[i].x;
+		__m256 halfX = _mm256_mul_ps(oneHalf, _mm256_i32gather_ps(box + 3, boxIndex, 4));
+		__m256 halfY = _mm256_mul_ps(oneHalf, _mm256_i32gather_ps(box + 4, boxIndex, 4));
+		__m256 halfZ = _mm256_mul_ps(oneHalf, _mm256_i32gather_ps(box + 5, boxIndex, 4));
+		__m256 centerX = _mm256_add_ps(_mm256_i32gather_ps(box, boxIndex, 4), halfX);
+		__m256 centerY = _mm256_add_ps(_mm256_i32gather_ps(box + 1, boxIndex, 4), halfY);
+		__m256 centerZ = _mm256_add_ps(_mm256_i32gather_ps(box + 2, boxIndex, 4), halfZ);
+		for (int r = 0; r < 3; r++)
+		{
+			__m256 worldCenter = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(column[0][r], centerX), _mm256_mul_ps(column[1][r], centerY)),
+					_mm256_add_ps(_mm256_mul_ps(column[2][r], centerZ), column[3][r]));
+			__m256 worldHalf = _mm256_add_ps(_mm256_add_ps(
+						_mm256_mul_ps(absolute(column[0][r]), halfX), _mm256_mul_ps(absolute(column[1][r]), halfY)),
+					_mm256_mul_ps(absolute(column[2][r]), halfZ));
+			_mm256_storeu_ps(min[r] + i, _mm256_sub_ps(worldCenter, worldHalf));
+			_mm256_storeu_ps(max[r] + i, _mm256_add_ps(worldCenter, worldHalf));
+		}
+	}
+	transformBoxesScalar(matrices, boxes, count, worldBoxes, i);
+}
+
+#else
+
+// Built without -mavx2, so fall back to the scalar kernels.
+void TransformBatch::composeAvx2(const TransformList& transforms, glm::mat4* matrices)
+{
+	composeScalar(transforms, matrices);
+}
+
+void TransformBatch::transformBoxesAvx2(const glm::mat4* matrices, const BoundingBox* boxes, std::size_t count,
+		BoxList& worldBoxes)
+{
+	transformBoxesScalar(matrices, boxes, count, worldBoxes);
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include <vector>
+#include <glm/gtc/packing.hpp>
+
+#include "TurbulenceVolume.h"
+
+/**
+ * period is in model space units and must be a power of two no larger
+ * than 256 so every octave of the lattice wraps with the texture.
+ */
+TurbulenceVolume::TurbulenceVolume(int period) :
+	period(period)
+{
+	glGenTextures(1, &id);
+	glBindTexture(GL_TEXTURE_3D, id);
+
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, SIZE, SIZE, SIZE, 0, GL_RED, GL_HALF_FLOAT, nullptr);
+
+	glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+TurbulenceVolume::~TurbulenceVolume()
+{
+	glDeleteTextures(1, &id);
+}
+
+unsigned int TurbulenceVolume::getId() const
+{
+	return id;
+}
+
+int TurbulenceVolume::getPeriod() const
+{
+	return period;
+}
+
+/**
+ * Turbulence tiling every period units, sampled at the voxel centers,
+ * which is where trilinear filtering returns the stored value exactly.
+ * The voxels are half floats, one batch noise call per z slice, all on
+ * the calling thread.
+ */
+std::vector<unsigned short> TurbulenceVolume::bake(const Noise& noise, int period,
+		float persistence, int octaves, int start, float offset)
+{
+	const std::size_t sliceSize = SIZE * SIZE;
+	const float voxelSize = float(period) / SIZE;
+	std::vector<unsigned short> voxels(sliceSize * SIZE);
+
+	std::vector<float> x(sliceSize), y(sliceSize), z(sliceSize), out(sliceSize);
+	for (std::size_t k = 0; k < SIZE; k++)
+	{
+		for (std::size_t j = 0; j < SIZE; j++)
+		{
+			for (std::size_t i = 0; i < SIZE; i++)
+			{
+				x[j*SIZE + i] = (i + 0.5f) * voxelSize;
+				y[j*SIZE + i] = (j + 0.5f) * voxelSize;
+				z[j*SIZE + i] = (k + 0.5f) * voxelSize;
+			}
+		}
+
+		noise.turbulence(x.data(), y.data(), z.data(), out.data(), sliceSize,
+				persistence, octaves, start, offset, period);
+		for (std::size_t i = 0; i < sliceSize; i++)
+			voxels[k*sliceSize + i] = glm::packHalf1x16(out[i]);
+	}
+	return voxels;
+}
+
+/**
+ * Replaces the volume's contents with voxels from bake() made with this
+ * volume's period.
+ */
+void TurbulenceVolume::upload(const std::vector<unsigned short>& voxels)
+{
+	glBindTexture(GL_TEXTURE_3D, id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, SIZE, SIZE, SIZE, GL_RED, GL_HALF_FLOAT, voxels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+/**
+ *	Sets the current active texture to the one specified in the parameter,
+ *	and then binds the volume.
+ */
+void TurbulenceVolume::bind(GLenum texture) const
+{
+	glActiveTexture(texture);
+	glBindTexture(GL_TEXTURE_3D, id);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+#include <noise/Noise.h>
+
+/**
+ * A 3D texture holding turbulence that tiles every getPeriod() units.
+ * The fragment shader samples it with trilinear filtering in place of
+ * evaluating every octave per fragment. bake() needs no GL context, so
+ * the voxels can be made on a worker and upload()ed on the render thread.
+ */
+
+class TurbulenceVolume
+{
+	public:
+		static const int SIZE = 128;
+
+		TurbulenceVolume(int period);
+		~TurbulenceVolume();
+		unsigned int getId() const;
+		int getPeriod() const;
+		void upload(const std::vector<unsigned short>& voxels);
+		void bind(GLenum texture) const;
+
+		static std::vector<unsigned short> bake(const Noise& noise, int period,
+				float persistence, int octaves, int start, float offset);
+
+	private:
+		unsigned int id;
+		int period;
+};
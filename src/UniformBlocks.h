@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+/*
+ * C++ mirrors of the std140 uniform blocks and the instance attributes
+ * declared in vertex.glsl and fragment.glsl. The member order and
+ * padding must match the shaders.
+ */
+
+struct FrameBlock
+{
+	static const unsigned int BINDING = 0;
+
+	glm::mat4 view;
+	glm::mat4 perspective;
+	glm::vec3 toCamera;
+	float time;
+	glm::vec3 lightPos;
+	float padding;
+};
+
+struct ModelBlock
+{
+	static const unsigned int BINDING = 1;
+
+	glm::mat4 model;
+	int effect;
+	float persistence;
+	int octaveCount;
+	int octaveStart;
+	float ringFreq;
+	int waveCenters;
+	float phaseSpeed;
+	int bakedTurbulence;	// a bool in the shader, which std140 stores in 4 bytes.
+	float turbulencePeriod;
+	float padding[3];
+};
+
+/*
+ * One instance of an instanced draw. vertex.glsl reads it as vertex
+ * attributes with a divisor of 1 when INSTANCED is defined. It holds the
+ * ModelBlock settings an instanced model can use.
+ */
+struct InstanceData
+{
+	static const unsigned int LOCATION = 3;	// model takes LOCATION to LOCATION + 3.
+
+	glm::mat4 model;
+	glm::vec4 floats;	// persistence, ringFreq, phaseSpeed, unused
+	glm::ivec4 ints;	// effect, octaveCount, octaveStart, waveCenters
+};
+
+static_assert(sizeof(FrameBlock) == 160, "FrameBlock must match the std140 layout");
+static_assert(sizeof(ModelBlock) == 112, "ModelBlock must match the std140 layout");
+static_assert(sizeof(InstanceData) == 96, "InstanceData must be tightly packed");
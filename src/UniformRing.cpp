@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cstring>
+
+#include "UniformRing.h"
+
+UniformRing::UniformRing(std::size_t blockSize, unsigned int slotCount) :
+	id(0), blockSize(blockSize), slotCount(std::max(slotCount, 1u)), usedSlots(0),
+	frameCount(1), frame(0), mapped(nullptr), uploadCount(0)
+{
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	stride = (blockSize + alignment - 1) / alignment * alignment;
+
+	// Persistent mapping needs GL 4.4, which is where glad loads
+	// glBufferStorage from.
+	if (glad_glBufferStorage)
+		frameCount = FRAMES_IN_FLIGHT;
+	fences.resize(frameCount, nullptr);
+
+	create();
+}
+
+UniformRing::~UniformRing()
+{
+	destroy();
+	for (GLsync fence : fences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+	}
+}
+
+void UniformRing::create()
+{
+	std::size_t size = stride * slotCount * frameCount;
+	glGenBuffers(1, &id);
+	glBindBuffer(GL_UNIFORM_BUFFER, id);
+	if (isPersistent())
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+		mapped = static_cast<char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+	}
+	else
+	{
+		glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// Nothing has been written yet. Versions start at 1.
+	versions.assign(slotCount * frameCount, 0);
+}
+
+void UniformRing::destroy()
+{
+	if (mapped)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, id);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		mapped = nullptr;
+	}
+	glDeleteBuffers(1, &id);
+}
+
+/**
+ * Returns a new slot. The buffer doubles in size when it is full, which
+ * discards what was written so every slot is uploaded again.
+ */
+unsigned int UniformRing::allocate()
+{
+	if (usedSlots == slotCount)
+	{
+		destroy();
+		slotCount *= 2;
+		create();
+	}
+	return usedSlots++;
+}
+
+/**
+ * Moves on to the next frame's copy of the slots and waits until the
+ * GPU has finished the frame that last used it.
+ */
+void UniformRing::beginFrame()
+{
+	uploadCount = 0;
+	frame = (frame + 1) % frameCount;
+	GLsync& fence = fences[frame];
+	if (fence)
+	{
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+}
+
+/**
+ * Marks the point in the command stream after which the current frame's
+ * copy may be written again. Only needed when persistently mapped.
+ */
+void UniformRing::endFrame()
+{
+	if (isPersistent())
+		fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/**
+ * Copies one block into the slot for the current frame unless it already
+ * holds the given version. Returns whether anything was uploaded.
+ */
+bool UniformRing::write(unsigned int slot, const void* data, unsigned int version)
+{
+	unsigned int& written = versions[frame * slotCount + slot];
+	if (written == version)
+		return false;
+
+	if (isPersistent())
+	{
+		std::memcpy(mapped + offset(slot), data, blockSize);
+	}
+	else
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, id);
+		glBufferSubData(GL_UNIFORM_BUFFER, offset(slot), blockSize, data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	written = version;
+	uploadCount++;
+	return true;
+}
+
+/**
+ * Binds the current frame's copy of a slot to a uniform block binding point.
+ */
+void UniformRing::bind(unsigned int slot, unsigned int binding) const
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, id, offset(slot), blockSize);
+}
+
+bool UniformRing::isPersistent() const
+{
+	return frameCount > 1;
+}
+
+/**
+ * Returns how many blocks were uploaded since beginFrame().
+ */
+unsigned int UniformRing::getUploadCount() const
+{
+	return uploadCount;
+}
+
+std::size_t UniformRing::offset(unsigned int slot) const
+{
+	return (std::size_t(frame) * slotCount + slot) * stride;
+}
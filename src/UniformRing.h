@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+/**
+ * A uniform buffer split into slots of one block each, bound to a
+ * uniform block with glBindBufferRange().
+ *
+ * When glBufferStorage is available the buffer is persistently mapped
+ * and repeated once per frame in flight, with a fence guarding each
+ * copy so the CPU never writes data the GPU is still reading. Otherwise
+ * there is one copy updated with glBufferSubData.
+ *
+ * write() takes a version number and skips the upload when the slot of
+ * the current frame already holds that version, so data that does not
+ * change stops being uploaded once every copy has it.
+ */
+
+class UniformRing
+{
+	public:
+		UniformRing(std::size_t blockSize, unsigned int slotCount = 1);
+		~UniformRing();
+		unsigned int allocate();
+		void beginFrame();
+		void endFrame();
+		bool write(unsigned int slot, const void* data, unsigned int version);
+		void bind(unsigned int slot, unsigned int binding) const;
+		bool isPersistent() const;
+		unsigned int getUploadCount() const;
+
+	private:
+		static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+		unsigned int id;
+		std::size_t blockSize;
+		std::size_t stride;			// blockSize rounded up to the offset alignment.
+		unsigned int slotCount;
+		unsigned int usedSlots;
+		unsigned int frameCount;	// copies of the slots, one per frame in flight.
+		unsigned int frame;
+		char* mapped;
+		std::vector<GLsync> fences;
+		std::vector<unsigned int> versions;	// per frame copy and slot.
+		unsigned int uploadCount;
+
+		void create();
+		void destroy();
+		std::size_t offset(unsigned int slot) const;
+};
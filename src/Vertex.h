@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <cstdint>
 
 struct Vertex
 {
@@ -8,3 +9,17 @@ struct Vertex
 	glm::vec3 normal;
 	glm::vec2 texture;
 };
+
+/*
+ * The 12 byte layout of Mesh::COMPACT. position holds x, y and z as
+ * fractions of the mesh's BoundingBox in 1/65535 steps, plus padding to
+ * keep the normal 4 byte aligned. normal is an octahedral encoding as two
+ * snorms. vertex.glsl turns both back into floats.
+ */
+struct CompactVertex
+{
+	std::uint16_t position[4];
+	std::int16_t normal[2];
+};
+
+static_assert(sizeof(CompactVertex) == 12, "CompactVertex must be tightly packed");
@@ -1,7 +1,14 @@
 #include <glad/glad.h>
 #include "VertexArray.h"
+#include "UniformBlocks.h"
 
-VertexArray::VertexArray(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+VertexArray::VertexArray(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices) :
+	VertexArray(vertices.data(), vertices.size(), indices.data(), indices.size())
+{
+}
+
+VertexArray::VertexArray(const Vertex* vertices, std::size_t vertexCount,
+		const unsigned int* indices, std::size_t indexCount)
 {
     glGenBuffers(1, &vertexBufferId); // gen buffer and store id in VBO
 	glGenBuffers(1, &elementBufferId);
@@ -9,10 +16,10 @@ VertexArray::VertexArray(const std::vector<Vertex> &vertices, const std::vector<
     
     glBindVertexArray(id);
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId);
-	glBufferData(GL_ARRAY_BUFFER,  vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER,  vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferId);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER,  indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER,  indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
 
 	// set the vertex attribute pointers
 	// vertex Positions
@@ -32,6 +39,33 @@ VertexArray::VertexArray(const std::vector<Vertex> &vertices, const std::vector<
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
+VertexArray::VertexArray(const CompactVertex* vertices, std::size_t vertexCount,
+		const void* indices, std::size_t indexSize, std::size_t indexCount)
+{
+	glGenBuffers(1, &vertexBufferId);
+	glGenBuffers(1, &elementBufferId);
+	glGenVertexArrays(1, &id);
+
+	glBindVertexArray(id);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(CompactVertex), vertices, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferId);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, indices, GL_STATIC_DRAW);
+
+	// Normalized, so the shader reads positions in [0, 1] and normals in
+	// [-1, 1]. There are no texture coordinates.
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex),
+			(void*)offsetof(CompactVertex, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, normal));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
 VertexArray::~VertexArray()
 {
     glDeleteVertexArrays(1, &id);
@@ -48,3 +82,46 @@ void VertexArray::bind() const
 {
 	glBindVertexArray(id);
 }
+
+/**
+ * Overwrites count vertices starting at vertex first, for vertex arrays
+ * made without data that are filled a part at a time.
+ */
+void VertexArray::setVertices(std::size_t first, const Vertex* vertices, std::size_t count) const
+{
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId);
+	glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(Vertex), count * sizeof(Vertex), vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * Binds the vertex array and points its instance attributes at the
+ * InstanceData in instanceBufferId, starting with instance first.
+ * GL 3.3 has no base instance for draws, so the offset goes into the
+ * attribute pointers instead.
+ */
+void VertexArray::bindInstances(unsigned int instanceBufferId, std::size_t first) const
+{
+	glBindVertexArray(id);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBufferId);
+	std::size_t base = first * sizeof(InstanceData);
+	// A mat4 attribute takes one location per column.
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		unsigned int location = InstanceData::LOCATION + i;
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+				(void*)(base + offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(location, 1);
+	}
+	unsigned int location = InstanceData::LOCATION + 4;
+	glEnableVertexAttribArray(location);
+	glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			(void*)(base + offsetof(InstanceData, floats)));
+	glVertexAttribDivisor(location, 1);
+	location++;
+	glEnableVertexAttribArray(location);
+	glVertexAttribIPointer(location, 4, GL_INT, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, ints)));
+	glVertexAttribDivisor(location, 1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
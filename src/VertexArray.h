@@ -13,9 +13,18 @@ class VertexArray
 		 * 		indices: Used to index into vertices allowing triangles to share vertices.
         */
 		VertexArray(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices);
+		VertexArray(const Vertex* vertices, std::size_t vertexCount,
+				const unsigned int* indices, std::size_t indexCount);
+		/**
+		 * indexSize is 2 for unsigned short and 4 for unsigned int indices.
+		 */
+		VertexArray(const CompactVertex* vertices, std::size_t vertexCount,
+				const void* indices, std::size_t indexSize, std::size_t indexCount);
 		~VertexArray();
 		unsigned int getId() const;
 		void bind() const;
+		void setVertices(std::size_t first, const Vertex* vertices, std::size_t count) const;
+		void bindInstances(unsigned int instanceBufferId, std::size_t first) const;
 
 	private:
 		unsigned int id;
@@ -5,25 +5,62 @@
 #include <iostream>
 
 #include "Renderer.h"
+#include "Benchmark.h"
 
 int main(int argc, char *argv[])
 {
 	int seed = 0;
-	if (argc >= 2)
+	std::string benchmark;
+	PermSource::Type permSource = PermSource::UNIFORM;
+	Mesh::VertexFormat vertexFormat = Mesh::FULL;
+	for (int i = 1; i < argc; i++)
 	{
+		std::string arg = argv[i];
+		if (arg == "--bench" && i + 1 < argc)
+		{
+			benchmark = argv[++i];
+			continue;
+		}
+		if (arg == "--perm" && i + 1 < argc)
+		{
+			if (!PermSource::parse(argv[++i], permSource))
+			{
+				std::cerr << "Unknown perm source " << argv[i] << ". Use uniform, texture or hash.\n";
+				return -1;
+			}
+			continue;
+		}
+		if (arg == "--vertices" && i + 1 < argc)
+		{
+			std::string format = argv[++i];
+			if (format != "full" && format != "compact")
+			{
+				std::cerr << "Unknown vertex format " << format << ". Use full or compact.\n";
+				return -1;
+			}
+			vertexFormat = format == "compact" ? Mesh::COMPACT : Mesh::FULL;
+			continue;
+		}
+
 		try
 		{
-			seed = std::stoi(argv[1]);
+			seed = std::stoi(arg);
 			std::cout << seed;
 		}
 		catch (std::invalid_argument& ia)
 		{
-			std::cerr << "Usage: ./myapp <seed>\n";
+			std::cerr << "Usage: ./myapp [seed] [--perm uniform|texture|hash] [--vertices full|compact] [--bench <name>]\n";
 			return -1;
 		}
 	}
+
+	if (!benchmark.empty())
+	{
+		return Benchmark::run(benchmark, seed);
+	}
+
 	{
-		Renderer renderer(seed);
+		Renderer renderer(seed, permSource, vertexFormat);
 		renderer.run();
 	}
 	// Need to terminate GLFW context after all OpenGL objects are deleted.
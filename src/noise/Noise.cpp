@@ -0,0 +1,503 @@
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "Noise.h"
+#include "NoiseKernels.h"
+
+namespace
+{
+	struct Dispatch
+	{
+		Noise::Isa isa;
+		NoiseKernels::Noise2Fn noise2;
+		NoiseKernels::Noise3Fn noise3;
+		NoiseKernels::Noise3GradFn noise3Grad;
+		NoiseKernels::TurbulenceFn turbulence;
+	};
+
+	Dispatch makeDispatch(Noise::Isa isa)
+	{
+		switch (isa)
+		{
+			case Noise::AVX2:
+				return { isa, NoiseKernels::noise2Avx2, NoiseKernels::noise3Avx2,
+					NoiseKernels::noise3GradAvx2, NoiseKernels::turbulenceAvx2 };
+			case Noise::SSE41:
+				// The gradient has no four lane kernel, it is mostly table lookups.
+				return { isa, NoiseKernels::noise2Sse41, NoiseKernels::noise3Sse41,
+					NoiseKernels::noise3GradScalar, NoiseKernels::turbulenceSse41 };
+			default:
+				return { Noise::SCALAR, NoiseKernels::noise2Scalar, NoiseKernels::noise3Scalar,
+					NoiseKernels::noise3GradScalar, NoiseKernels::turbulenceScalar };
+		}
+	}
+
+	Dispatch& dispatch()
+	{
+		// Pick the widest instruction set the CPU supports the first time
+		// any batch function is called.
+		static Dispatch current = makeDispatch(
+				Noise::isSupported(Noise::AVX2) ? Noise::AVX2 :
+				Noise::isSupported(Noise::SSE41) ? Noise::SSE41 : Noise::SCALAR);
+		return current;
+	}
+
+	/**
+	 * Input a t in the range [0,1] and outputs
+	 * a smoothed values also in the range [0,1].
+	 * Uses the function 6t^5 - 15t^4 + 10t^3
+	 */
+	inline float ease(float t)
+	{
+		return ((6*t - 15)*t + 10)*t*t*t;
+	}
+
+	/**
+	 * The derivative of ease().
+	 * Uses the function 30t^4 - 60t^3 + 30t^2
+	 */
+	inline float easeDerivative(float t)
+	{
+		return 30*t*t*((t - 2)*t + 1);
+	}
+
+	// GLSL mix().
+	inline float mix(float x, float y, float a)
+	{
+		return x*(1 - a) + y*a;
+	}
+
+	/**
+	 * Returns the frequency 2^i and amplitude persistence^i of every
+	 * octave i in [start, octaves). If period is not 0 the lattice of the
+	 * ith octave wraps every period * 2^i units, capped at the 256 the
+	 * permutation table repeats at anyway.
+	 */
+	std::vector<NoiseKernels::Octave> octaveWeights(float persistence, int octaves, int start, int period)
+	{
+		std::vector<NoiseKernels::Octave> weights;
+		for (int i = start; i < octaves; i++)
+		{
+			int mask = 255;
+			if (period > 0 && i < 8)
+				mask = glm::min(period << i, 256) - 1;
+			weights.push_back({ std::pow(2.0f, float(i)), std::pow(persistence, float(i)), mask });
+		}
+		return weights;
+	}
+}
+
+Noise::Noise(int seed, Permutation permutation) :
+	seed(seed), permutation(permutation)
+{
+	for (unsigned int i = 0; i < 256; i++)
+		perm[i] = permutation == HASHED ? hash(i, hashKey(seed)) : i;
+	if (permutation == SHUFFLED)
+		shuffle(perm, seed);
+	for (unsigned int i = 0; i < 256; i++)
+		perm[i + 256] = perm[i];
+}
+
+/**
+ * Shuffles the identity permutation with std::rand. The shaders and
+ * the CPU must use the same table so every caller goes through here.
+ */
+void Noise::shuffle(int perm[256], int seed)
+{
+	std::srand(seed);
+	for(unsigned int i = 0; i < 256; i++)
+	{
+		int rand = std::rand() % 256;
+		int tmp = perm[i];
+		perm[i] = perm[rand];
+		perm[rand] = tmp;
+	}
+}
+
+/**
+ * Mixes the seed into the four bytes of key used by hash().
+ */
+unsigned int Noise::hashKey(int seed)
+{
+	unsigned int x = static_cast<unsigned int>(seed) * 0x9E3779B9u;
+	x ^= x >> 16;
+	x *= 0x85EBCA6Bu;
+	x ^= x >> 13;
+	return x;
+}
+
+/**
+ * A permutation of 0 to 255 chosen by key, computed without a table.
+ * Every step (xor or add a constant, multiply by an odd number, xor
+ * with a right shift) is invertible on 8 bits, so the result is always
+ * a permutation. Must match perm() in noise.glsl when PERM_HASH is
+ * defined.
+ */
+int Noise::hash(int i, unsigned int key)
+{
+	unsigned int x = (static_cast<unsigned int>(i) & 255u) ^ (key & 255u);
+	x = (x * 109u + ((key >> 8) & 255u)) & 255u;
+	x ^= x >> 4;
+	x = (x * 181u + ((key >> 16) & 255u)) & 255u;
+	x ^= x >> 3;
+	x = (x * 75u + (key >> 24)) & 255u;
+	x ^= x >> 4;
+	return x;
+}
+
+int Noise::getSeed() const
+{
+	return seed;
+}
+
+Noise::Permutation Noise::getPermutation() const
+{
+	return permutation;
+}
+
+unsigned int Noise::getHashKey() const
+{
+	return hashKey(seed);
+}
+
+const int* Noise::getPerm() const
+{
+	return perm;
+}
+
+/**
+ * Computes the 2D perlin noise. Returns a value in the range [0,1].
+ */
+float Noise::noise(const glm::vec2& vec) const
+{
+	return NoiseKernels::noise2(perm, vec.x, vec.y);
+}
+
+/**
+ * Computes the 3D perlin noise. Returns a value in the range [0,1].
+ */
+float Noise::noise(const glm::vec3& vec) const
+{
+	return NoiseKernels::noise3(perm, vec.x, vec.y, vec.z);
+}
+
+/**
+ * Computes the 3D perlin noise and stores its analytic gradient in
+ * gradient. Returns the same value as noise(vec).
+ */
+float Noise::noise(const glm::vec3& vec, glm::vec3& gradient) const
+{
+	float grad[3];
+	float value = NoiseKernels::noise3Grad(perm, vec.x, vec.y, vec.z, grad);
+	gradient = glm::vec3(grad[0], grad[1], grad[2]);
+	return value;
+}
+
+/**
+ * Sums the octaves [start, octaves) of 3D noise at vec. The ith octave
+ * has frequency 2^i and amplitude persistence^i.
+ */
+float Noise::turbulence(const glm::vec3& vec, float persistence, int octaves, int start, float offset) const
+{
+	float total = 0;
+	for (int i = start; i < octaves; i++)
+	{
+		float freq = std::pow(2.0f, float(i));
+		float amp = std::pow(persistence, float(i));
+		total += NoiseKernels::noise3(perm, vec.x * freq + offset, vec.y * freq + offset,
+				vec.z * freq + offset) * amp;
+	}
+	return total;
+}
+
+void Noise::noise(const float* x, const float* y, float* out, std::size_t count) const
+{
+	dispatch().noise2(perm, x, y, out, count);
+}
+
+void Noise::noise(const float* x, const float* y, const float* z, float* out, std::size_t count) const
+{
+	dispatch().noise3(perm, x, y, z, out, count);
+}
+
+void Noise::noise(const float* x, const float* y, const float* z, float* out,
+		float* dx, float* dy, float* dz, std::size_t count) const
+{
+	dispatch().noise3Grad(perm, x, y, z, out, dx, dy, dz, count);
+}
+
+void Noise::turbulence(const float* x, const float* y, const float* z, float* out, std::size_t count,
+		float persistence, int octaves, int start, float offset) const
+{
+	std::vector<NoiseKernels::Octave> weights = octaveWeights(persistence, octaves, start, 0);
+	dispatch().turbulence(perm, x, y, z, out, count, weights.data(), weights.size(), offset);
+}
+
+/**
+ * Turbulence that repeats every period units along each axis, for baking
+ * into textures that wrap. period must be a power of two no larger than
+ * 256. Matches the other turbulence() when period is 256.
+ */
+void Noise::turbulence(const float* x, const float* y, const float* z, float* out, std::size_t count,
+		float persistence, int octaves, int start, float offset, int period) const
+{
+	std::vector<NoiseKernels::Octave> weights = octaveWeights(persistence, octaves, start, period);
+	dispatch().turbulence(perm, x, y, z, out, count, weights.data(), weights.size(), offset);
+}
+
+Noise::Isa Noise::getIsa()
+{
+	return dispatch().isa;
+}
+
+/**
+ * Forces the batch functions to use the given instruction set.
+ * Returns false, leaving the current choice alone, if the CPU lacks it.
+ */
+bool Noise::setIsa(Isa isa)
+{
+	if (!isSupported(isa))
+		return false;
+
+	dispatch() = makeDispatch(isa);
+	return true;
+}
+
+bool Noise::isSupported(Isa isa)
+{
+	switch (isa)
+	{
+		case SCALAR:
+			return true;
+#if defined(__x86_64__) || defined(__i386__)
+		case SSE41:
+			return __builtin_cpu_supports("sse4.1");
+		case AVX2:
+			return __builtin_cpu_supports("avx2");
+#endif
+		default:
+			return false;
+	}
+}
+
+const char* Noise::getIsaName(Isa isa)
+{
+	const char* names[COUNT] = { "scalar", "sse4.1", "avx2" };
+	return names[isa];
+}
+
+/**
+ * The following code was adapted from https://rtouti.github.io/graphics/perlin-noise-algorithm
+ * A line by line port of noise(vec2) in noise.glsl.
+ */
+float NoiseKernels::noise2(const int* perm, float x, float y)
+{
+	// Get the lower left corner of the grid.
+	int xi = int(x) & 255;
+	int yi = int(y) & 255;
+
+	// Place the fractional part of point in [0,1]^2 the same way the
+	// shader does, including its use of sign().
+	float fracX = x - float(int(x));
+	float fracY = y - float(int(y));
+	float signX = fracX > 0 ? 1.0f : (fracX < 0 ? -1.0f : 0.0f);
+	float signY = fracY > 0 ? 1.0f : (fracY < 0 ? -1.0f : 0.0f);
+	fracX += (-signX + 1.0f) * 0.5f;
+	fracY += (-signY + 1.0f) * 0.5f;
+
+	int valueTopRight = perm[ perm[xi + 1] + yi + 1 ] & 3;
+	int valueTopLeft = perm[ perm[xi] + yi + 1 ] & 3;
+	int valueBotRight = perm[ perm[xi + 1] + yi ] & 3;
+	int valueBotLeft = perm[ perm[xi] + yi ] & 3;
+
+	float dotTopRight = (fracX - 1)*GRAD2_X[valueTopRight] + (fracY - 1)*GRAD2_Y[valueTopRight];
+	float dotTopLeft = (fracX - 0)*GRAD2_X[valueTopLeft] + (fracY - 1)*GRAD2_Y[valueTopLeft];
+	float dotBotRight = (fracX - 1)*GRAD2_X[valueBotRight] + (fracY - 0)*GRAD2_Y[valueBotRight];
+	float dotBotLeft = fracX*GRAD2_X[valueBotLeft] + fracY*GRAD2_Y[valueBotLeft];
+
+	float u = ease(fracX);
+	float v = ease(fracY);
+	float vert1 = mix(dotBotLeft, dotTopLeft, v);
+	float vert2 = mix(dotBotRight, dotTopRight, v);
+	float value = mix(vert1, vert2, u);
+
+	// put in range [0,1]. -2 <= dotprod <= 2.
+	return (value + 2.0f) * 0.25f;
+}
+
+/**
+ * The following code was adapted from
+ * 	(1) https://rtouti.github.io/graphics/perlin-noise-algorithm
+ * 	(2) https://mrl.cs.nyu.edu/~perlin/noise/
+ * A line by line port of noise(vec3) in noise.glsl.
+ */
+float NoiseKernels::noise3(const int* perm, float x, float y, float z, int mask)
+{
+	// Get the lower back left corner of the cube and the corner opposite it.
+	float floorX = std::floor(x);
+	float floorY = std::floor(y);
+	float floorZ = std::floor(z);
+	int xi = int(floorX) & mask;
+	int yi = int(floorY) & mask;
+	int zi = int(floorZ) & mask;
+	int xi1 = (xi + 1) & mask;
+	int yi1 = (yi + 1) & mask;
+	int zi1 = (zi + 1) & mask;
+
+	float fracX = x - floorX;
+	float fracY = y - floorY;
+	float fracZ = z - floorZ;
+
+	int a = perm[xi];
+	int b = perm[xi1];
+	int aa = perm[a + yi];
+	int ab = perm[a + yi1];
+	int ba = perm[b + yi];
+	int bb = perm[b + yi1];
+
+	int values[8] = {
+		perm[bb + zi1], perm[ab + zi1], perm[ba + zi1], perm[aa + zi1],	// front
+		perm[bb + zi], perm[ab + zi], perm[ba + zi], perm[aa + zi] };	// back
+
+	// Offsets of the corners from the lower back left corner, in the
+	// same order as values.
+	const float cornerX[8] = { 1, 0, 1, 0, 1, 0, 1, 0 };
+	const float cornerY[8] = { 1, 1, 0, 0, 1, 1, 0, 0 };
+	const float cornerZ[8] = { 1, 1, 1, 1, 0, 0, 0, 0 };
+
+	float dots[8];
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		int g = values[i] & 7;
+		dots[i] = (fracX - cornerX[i])*GRAD3_X[g] + (fracY - cornerY[i])*GRAD3_Y[g] +
+			(fracZ - cornerZ[i])*GRAD3_Z[g];
+	}
+
+	float u = ease(fracX);
+	float v = ease(fracY);
+	float w = ease(fracZ);
+	float frontVert1 = mix(dots[3], dots[1], v);
+	float frontVert2 = mix(dots[2], dots[0], v);
+	float frontHorz = mix(frontVert1, frontVert2, u);
+	float backVert1 = mix(dots[7], dots[5], v);
+	float backVert2 = mix(dots[6], dots[4], v);
+	float backHorz = mix(backVert1, backVert2, u);
+	float value = mix(backHorz, frontHorz, w);
+
+	// put in range [0,1]. -3 <= dotprod <= 3.
+	return (value + 3.0f) * 0.16667f;
+}
+
+/**
+ * noise3() with the gradient of noise(vec3, out vec3) in noise.glsl.
+ * The value is trilinear in the eased (u, v, w), so its gradient is the
+ * corner gradients blended with the same weights plus the rate of change
+ * of the weights themselves.
+ */
+float NoiseKernels::noise3Grad(const int* perm, float x, float y, float z, float gradient[3])
+{
+	float floorX = std::floor(x);
+	float floorY = std::floor(y);
+	float floorZ = std::floor(z);
+	int xi = int(floorX) & 255;
+	int yi = int(floorY) & 255;
+	int zi = int(floorZ) & 255;
+
+	float fracX = x - floorX;
+	float fracY = y - floorY;
+	float fracZ = z - floorZ;
+
+	int a = perm[xi] + yi;
+	int b = perm[xi + 1] + yi;
+	int aa = perm[a];
+	int ab = perm[a + 1];
+	int ba = perm[b];
+	int bb = perm[b + 1];
+
+	int values[8] = {
+		perm[bb + zi + 1], perm[ab + zi + 1], perm[ba + zi + 1], perm[aa + zi + 1],	// front
+		perm[bb + zi], perm[ab + zi], perm[ba + zi], perm[aa + zi] };			// back
+
+	const float cornerX[8] = { 1, 0, 1, 0, 1, 0, 1, 0 };
+	const float cornerY[8] = { 1, 1, 0, 0, 1, 1, 0, 0 };
+	const float cornerZ[8] = { 1, 1, 1, 1, 0, 0, 0, 0 };
+
+	float dots[8];
+	float grads[3][8];
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		int g = values[i] & 7;
+		grads[0][i] = GRAD3_X[g];
+		grads[1][i] = GRAD3_Y[g];
+		grads[2][i] = GRAD3_Z[g];
+		dots[i] = (fracX - cornerX[i])*GRAD3_X[g] + (fracY - cornerY[i])*GRAD3_Y[g] +
+			(fracZ - cornerZ[i])*GRAD3_Z[g];
+	}
+
+	float u = ease(fracX);
+	float v = ease(fracY);
+	float w = ease(fracZ);
+	float frontHorz = mix(mix(dots[3], dots[1], v), mix(dots[2], dots[0], v), u);
+	float backHorz = mix(mix(dots[7], dots[5], v), mix(dots[6], dots[4], v), u);
+	float value = mix(backHorz, frontHorz, w);
+
+	float rates[3] = {
+		easeDerivative(fracX) * mix(mix(dots[6] - dots[7], dots[4] - dots[5], v),
+				mix(dots[2] - dots[3], dots[0] - dots[1], v), w),
+		easeDerivative(fracY) * mix(mix(dots[5] - dots[7], dots[4] - dots[6], u),
+				mix(dots[1] - dots[3], dots[0] - dots[2], u), w),
+		easeDerivative(fracZ) * (frontHorz - backHorz) };
+
+	for (unsigned int c = 0; c < 3; c++)
+	{
+		const float* g = grads[c];
+		float front = mix(mix(g[3], g[1], v), mix(g[2], g[0], v), u);
+		float back = mix(mix(g[7], g[5], v), mix(g[6], g[4], v), u);
+		gradient[c] = (mix(back, front, w) + rates[c]) * 0.16667f;
+	}
+
+	return (value + 3.0f) * 0.16667f;
+}
+
+void NoiseKernels::noise2Scalar(const int* perm, const float* x, const float* y, float* out, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; i++)
+		out[i] = noise2(perm, x[i], y[i]);
+}
+
+void NoiseKernels::noise3Scalar(const int* perm, const float* x, const float* y, const float* z,
+		float* out, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; i++)
+		out[i] = noise3(perm, x[i], y[i], z[i]);
+}
+
+void NoiseKernels::noise3GradScalar(const int* perm, const float* x, const float* y, const float* z,
+		float* out, float* dx, float* dy, float* dz, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; i++)
+	{
+		float gradient[3];
+		out[i] = noise3Grad(perm, x[i], y[i], z[i], gradient);
+		dx[i] = gradient[0];
+		dy[i] = gradient[1];
+		dz[i] = gradient[2];
+	}
+}
+
+void NoiseKernels::turbulenceScalar(const int* perm, const float* x, const float* y, const float* z,
+		float* out, std::size_t count, const Octave* octaves, int octaveCount, float offset)
+{
+	for (std::size_t i = 0; i < count; i++)
+	{
+		float total = 0;
+		for (int o = 0; o < octaveCount; o++)
+		{
+			const Octave& octave = octaves[o];
+			total += noise3(perm, x[i] * octave.freq + offset, y[i] * octave.freq + offset,
+					z[i] * octave.freq + offset, octave.mask) * octave.amp;
+		}
+		out[i] = total;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+/*
+ * CPU reference implementation of the perlin noise found in
+ * shaders/noise.glsl. The scalar functions follow the shader
+ * operation for operation so the CPU and GPU agree on every value.
+ *
+ * The batch functions evaluate many points stored as separate x, y and z
+ * arrays (SoA). They use AVX2 or SSE4.1 when the CPU supports them and
+ * fall back to the scalar path otherwise.
+ */
+class Noise
+{
+	public:
+		enum Isa
+		{
+			SCALAR = 0,
+			SSE41,
+			AVX2,
+			/*
+			 * COUNT is not an Isa. It stores how many enums there are.
+			 */
+			COUNT
+		};
+
+		/*
+		 * How the permutation table is made from the seed. SHUFFLED uses
+		 * std::rand. HASHED uses hash(), which the shader can evaluate
+		 * without a table.
+		 */
+		enum Permutation
+		{
+			SHUFFLED = 0,
+			HASHED
+		};
+
+		static const int PERM_SIZE = 512;
+
+		Noise(int seed, Permutation permutation = SHUFFLED);
+		int getSeed() const;
+		Permutation getPermutation() const;
+		unsigned int getHashKey() const;
+		const int* getPerm() const;
+
+		float noise(const glm::vec2& vec) const;
+		float noise(const glm::vec3& vec) const;
+		float noise(const glm::vec3& vec, glm::vec3& gradient) const;
+		float turbulence(const glm::vec3& vec, float persistence, int octaves, int start, float offset) const;
+
+		void noise(const float* x, const float* y, float* out, std::size_t count) const;
+		void noise(const float* x, const float* y, const float* z, float* out, std::size_t count) const;
+		void noise(const float* x, const float* y, const float* z, float* out,
+				float* dx, float* dy, float* dz, std::size_t count) const;
+		void turbulence(const float* x, const float* y, const float* z, float* out, std::size_t count,
+				float persistence, int octaves, int start, float offset) const;
+		void turbulence(const float* x, const float* y, const float* z, float* out, std::size_t count,
+				float persistence, int octaves, int start, float offset, int period) const;
+
+		static void shuffle(int perm[256], int seed);
+		static unsigned int hashKey(int seed);
+		static int hash(int i, unsigned int key);
+		static Isa getIsa();
+		static bool setIsa(Isa isa);
+		static bool isSupported(Isa isa);
+		static const char* getIsaName(Isa isa);
+
+	private:
+		int seed;
+		Permutation permutation;
+		// The 256 entry permutation repeated twice so that
+		// perm[perm[x] + y] never needs to wrap.
+		alignas(32) int perm[PERM_SIZE];
+};
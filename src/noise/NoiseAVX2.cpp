@@ -0,0 +1,332 @@
+/*
+ * Eight lane batch kernels. This file is compiled with -mavx2 and is only
+ * called after Noise has checked that the CPU supports AVX2. FMA is left
+ * off so every lane rounds exactly like the scalar path.
+ */
+
+#include "NoiseKernels.h"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace
+{
+	inline __m256 ease(__m256 t)
+	{
+		__m256 r = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(6), t), _mm256_set1_ps(15));
+		r = _mm256_add_ps(_mm256_mul_ps(r, t), _mm256_set1_ps(10));
+		return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(r, t), t), t);
+	}
+
+	inline __m256 easeDerivative(__m256 t)
+	{
+		__m256 r = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(t, _mm256_set1_ps(2)), t), _mm256_set1_ps(1));
+		return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(30), t), t), r);
+	}
+
+	inline __m256 mix(__m256 x, __m256 y, __m256 a)
+	{
+		return _mm256_add_ps(_mm256_mul_ps(x, _mm256_sub_ps(_mm256_set1_ps(1), a)), _mm256_mul_ps(y, a));
+	}
+
+	inline __m256i lookup(const int* perm, __m256i index)
+	{
+		return _mm256_i32gather_epi32(perm, index, 4);
+	}
+
+	inline __m256 grad2Dot(__m256i value, __m256 x, __m256 y)
+	{
+		__m256i g = _mm256_and_si256(value, _mm256_set1_epi32(3));
+		__m256 gx = _mm256_permutevar8x32_ps(_mm256_load_ps(NoiseKernels::GRAD2_X), g);
+		__m256 gy = _mm256_permutevar8x32_ps(_mm256_load_ps(NoiseKernels::GRAD2_Y), g);
+		return _mm256_add_ps(_mm256_mul_ps(x, gx), _mm256_mul_ps(y, gy));
+	}
+
+	inline __m256 grad3Dot(__m256i value, __m256 x, __m256 y, __m256 z)
+	{
+		__m256i g = _mm256_and_si256(value, _mm256_set1_epi32(7));
+		__m256 gx = _mm256_permutevar8x32_ps(_mm256_load_ps(NoiseKernels::GRAD3_X), g);
+		__m256 gy = _mm256_permutevar8x32_ps(_mm256_load_ps(NoiseKernels::GRAD3_Y), g);
+		__m256 gz = _mm256_permutevar8x32_ps(_mm256_load_ps(NoiseKernels::GRAD3_Z), g);
+		return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, gx), _mm256_mul_ps(y, gy)), _mm256_mul_ps(z, gz));
+	}
+
+	__m256 noise2x8(const int* perm, __m256 x, __m256 y)
+	{
+		const __m256 one = _mm256_set1_ps(1);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256i mask = _mm256_set1_epi32(255);
+		const __m256i onei = _mm256_set1_epi32(1);
+
+		__m256i truncX = _mm256_cvttps_epi32(x);
+		__m256i truncY = _mm256_cvttps_epi32(y);
+		__m256i xi = _mm256_and_si256(truncX, mask);
+		__m256i yi = _mm256_and_si256(truncY, mask);
+
+		__m256 fracX = _mm256_sub_ps(x, _mm256_cvtepi32_ps(truncX));
+		__m256 fracY = _mm256_sub_ps(y, _mm256_cvtepi32_ps(truncY));
+		__m256 signX = _mm256_sub_ps(_mm256_and_ps(_mm256_cmp_ps(fracX, zero, _CMP_GT_OQ), one),
+				_mm256_and_ps(_mm256_cmp_ps(fracX, zero, _CMP_LT_OQ), one));
+		__m256 signY = _mm256_sub_ps(_mm256_and_ps(_mm256_cmp_ps(fracY, zero, _CMP_GT_OQ), one),
+				_mm256_and_ps(_mm256_cmp_ps(fracY, zero, _CMP_LT_OQ), one));
+		fracX = _mm256_add_ps(fracX, _mm256_mul_ps(_mm256_add_ps(_mm256_sub_ps(zero, signX), one), _mm256_set1_ps(0.5f)));
+		fracY = _mm256_add_ps(fracY, _mm256_mul_ps(_mm256_add_ps(_mm256_sub_ps(zero, signY), one), _mm256_set1_ps(0.5f)));
+
+		__m256i a = _mm256_add_epi32(lookup(perm, xi), yi);
+		__m256i b = _mm256_add_epi32(lookup(perm, _mm256_add_epi32(xi, onei)), yi);
+
+		__m256 fracX1 = _mm256_sub_ps(fracX, one);
+		__m256 fracY1 = _mm256_sub_ps(fracY, one);
+		__m256 dotTopRight = grad2Dot(lookup(perm, _mm256_add_epi32(b, onei)), fracX1, fracY1);
+		__m256 dotTopLeft = grad2Dot(lookup(perm, _mm256_add_epi32(a, onei)), _mm256_sub_ps(fracX, zero), fracY1);
+		__m256 dotBotRight = grad2Dot(lookup(perm, b), fracX1, _mm256_sub_ps(fracY, zero));
+		__m256 dotBotLeft = grad2Dot(lookup(perm, a), fracX, fracY);
+
+		__m256 u = ease(fracX);
+		__m256 v = ease(fracY);
+		__m256 value = mix(mix(dotBotLeft, dotTopLeft, v), mix(dotBotRight, dotTopRight, v), u);
+		return _mm256_mul_ps(_mm256_add_ps(value, _mm256_set1_ps(2.0f)), _mm256_set1_ps(0.25f));
+	}
+
+	__m256 noise3x8(const int* perm, __m256 x, __m256 y, __m256 z, __m256i mask)
+	{
+		const __m256 one = _mm256_set1_ps(1);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256i onei = _mm256_set1_epi32(1);
+
+		__m256 floorX = _mm256_floor_ps(x);
+		__m256 floorY = _mm256_floor_ps(y);
+		__m256 floorZ = _mm256_floor_ps(z);
+		__m256i xi = _mm256_and_si256(_mm256_cvttps_epi32(floorX), mask);
+		__m256i yi = _mm256_and_si256(_mm256_cvttps_epi32(floorY), mask);
+		__m256i zi = _mm256_and_si256(_mm256_cvttps_epi32(floorZ), mask);
+
+		__m256 fracX = _mm256_sub_ps(x, floorX);
+		__m256 fracY = _mm256_sub_ps(y, floorY);
+		__m256 fracZ = _mm256_sub_ps(z, floorZ);
+		__m256 fracX1 = _mm256_sub_ps(fracX, one);
+		__m256 fracY1 = _mm256_sub_ps(fracY, one);
+		__m256 fracZ1 = _mm256_sub_ps(fracZ, one);
+		__m256 fracX0 = _mm256_sub_ps(fracX, zero);
+		__m256 fracY0 = _mm256_sub_ps(fracY, zero);
+		__m256 fracZ0 = _mm256_sub_ps(fracZ, zero);
+
+		__m256i xi1 = _mm256_and_si256(_mm256_add_epi32(xi, onei), mask);
+		__m256i yi1 = _mm256_and_si256(_mm256_add_epi32(yi, onei), mask);
+		__m256i zi1 = _mm256_and_si256(_mm256_add_epi32(zi, onei), mask);
+		__m256i a = lookup(perm, xi);
+		__m256i b = lookup(perm, xi1);
+		__m256i aa = lookup(perm, _mm256_add_epi32(a, yi));
+		__m256i ab = lookup(perm, _mm256_add_epi32(a, yi1));
+		__m256i ba = lookup(perm, _mm256_add_epi32(b, yi));
+		__m256i bb = lookup(perm, _mm256_add_epi32(b, yi1));
+
+		__m256 dotFrontTopRight = grad3Dot(lookup(perm, _mm256_add_epi32(bb, zi1)), fracX1, fracY1, fracZ1);
+		__m256 dotFrontTopLeft = grad3Dot(lookup(perm, _mm256_add_epi32(ab, zi1)), fracX0, fracY1, fracZ1);
+		__m256 dotFrontBotRight = grad3Dot(lookup(perm, _mm256_add_epi32(ba, zi1)), fracX1, fracY0, fracZ1);
+		__m256 dotFrontBotLeft = grad3Dot(lookup(perm, _mm256_add_epi32(aa, zi1)), fracX0, fracY0, fracZ1);
+		__m256 dotBackTopRight = grad3Dot(lookup(perm, _mm256_add_epi32(bb, zi)), fracX1, fracY1, fracZ0);
+		__m256 dotBackTopLeft = grad3Dot(lookup(perm, _mm256_add_epi32(ab, zi)), fracX0, fracY1, fracZ0);
+		__m256 dotBackBotRight = grad3Dot(lookup(perm, _mm256_add_epi32(ba, zi)), fracX1, fracY0, fracZ0);
+		__m256 dotBackBotLeft = grad3Dot(lookup(perm, _mm256_add_epi32(aa, zi)), fracX0, fracY0, fracZ0);
+
+		__m256 u = ease(fracX);
+		__m256 v = ease(fracY);
+		__m256 w = ease(fracZ);
+		__m256 frontHorz = mix(mix(dotFrontBotLeft, dotFrontTopLeft, v), mix(dotFrontBotRight, dotFrontTopRight, v), u);
+		__m256 backHorz = mix(mix(dotBackBotLeft, dotBackTopLeft, v), mix(dotBackBotRight, dotBackTopRight, v), u);
+		__m256 value = mix(backHorz, frontHorz, w);
+		return _mm256_mul_ps(_mm256_add_ps(value, _mm256_set1_ps(3.0f)), _mm256_set1_ps(0.16667f));
+	}
+	struct Corner
+	{
+		__m256 dot, gx, gy, gz;
+	};
+
+	inline Corner grad3Corner(__m256i value, __m256 x, __m256 y, __m256 z)
+	{
+		__m256i g = _mm256_and_si256(value, _mm256_set1_epi32(7));
+		Corner corner;
+		corner.gx = _mm256_permutevar8x32_ps(_mm256_load_ps(NoiseKernels::GRAD3_X), g);
+		corner.gy = _mm256_permutevar8x32_ps(_mm256_load_ps(NoiseKernels::GRAD3_Y), g);
+		corner.gz = _mm256_permutevar8x32_ps(_mm256_load_ps(NoiseKernels::GRAD3_Z), g);
+		corner.dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, corner.gx), _mm256_mul_ps(y, corner.gy)),
+				_mm256_mul_ps(z, corner.gz));
+		return corner;
+	}
+
+	/**
+	 * Trilinear blend of one value across the eight corners, in the order
+	 * front top right, front top left, front bot right, front bot left,
+	 * then the same for the back.
+	 */
+	inline __m256 blend(const __m256 c[8], __m256 u, __m256 v, __m256 w)
+	{
+		__m256 front = mix(mix(c[3], c[1], v), mix(c[2], c[0], v), u);
+		__m256 back = mix(mix(c[7], c[5], v), mix(c[6], c[4], v), u);
+		return mix(back, front, w);
+	}
+
+	__m256 noise3Gradx8(const int* perm, __m256 x, __m256 y, __m256 z, __m256& dx, __m256& dy, __m256& dz)
+	{
+		const __m256 one = _mm256_set1_ps(1);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256i mask = _mm256_set1_epi32(255);
+		const __m256i onei = _mm256_set1_epi32(1);
+		const __m256 scale = _mm256_set1_ps(0.16667f);
+
+		__m256 floorX = _mm256_floor_ps(x);
+		__m256 floorY = _mm256_floor_ps(y);
+		__m256 floorZ = _mm256_floor_ps(z);
+		__m256i xi = _mm256_and_si256(_mm256_cvttps_epi32(floorX), mask);
+		__m256i yi = _mm256_and_si256(_mm256_cvttps_epi32(floorY), mask);
+		__m256i zi = _mm256_and_si256(_mm256_cvttps_epi32(floorZ), mask);
+
+		__m256 fracX = _mm256_sub_ps(x, floorX);
+		__m256 fracY = _mm256_sub_ps(y, floorY);
+		__m256 fracZ = _mm256_sub_ps(z, floorZ);
+		__m256 fracX1 = _mm256_sub_ps(fracX, one);
+		__m256 fracY1 = _mm256_sub_ps(fracY, one);
+		__m256 fracZ1 = _mm256_sub_ps(fracZ, one);
+		__m256 fracX0 = _mm256_sub_ps(fracX, zero);
+		__m256 fracY0 = _mm256_sub_ps(fracY, zero);
+		__m256 fracZ0 = _mm256_sub_ps(fracZ, zero);
+
+		__m256i a = _mm256_add_epi32(lookup(perm, xi), yi);
+		__m256i b = _mm256_add_epi32(lookup(perm, _mm256_add_epi32(xi, onei)), yi);
+		__m256i aa = _mm256_add_epi32(lookup(perm, a), zi);
+		__m256i ab = _mm256_add_epi32(lookup(perm, _mm256_add_epi32(a, onei)), zi);
+		__m256i ba = _mm256_add_epi32(lookup(perm, b), zi);
+		__m256i bb = _mm256_add_epi32(lookup(perm, _mm256_add_epi32(b, onei)), zi);
+
+		Corner corners[8] = {
+			grad3Corner(lookup(perm, _mm256_add_epi32(bb, onei)), fracX1, fracY1, fracZ1),
+			grad3Corner(lookup(perm, _mm256_add_epi32(ab, onei)), fracX0, fracY1, fracZ1),
+			grad3Corner(lookup(perm, _mm256_add_epi32(ba, onei)), fracX1, fracY0, fracZ1),
+			grad3Corner(lookup(perm, _mm256_add_epi32(aa, onei)), fracX0, fracY0, fracZ1),
+			grad3Corner(lookup(perm, bb), fracX1, fracY1, fracZ0),
+			grad3Corner(lookup(perm, ab), fracX0, fracY1, fracZ0),
+			grad3Corner(lookup(perm, ba), fracX1, fracY0, fracZ0),
+			grad3Corner(lookup(perm, aa), fracX0, fracY0, fracZ0) };
+
+		__m256 dots[8], gx[8], gy[8], gz[8];
+		for (unsigned int i = 0; i < 8; i++)
+		{
+			dots[i] = corners[i].dot;
+			gx[i] = corners[i].gx;
+			gy[i] = corners[i].gy;
+			gz[i] = corners[i].gz;
+		}
+
+		__m256 u = ease(fracX);
+		__m256 v = ease(fracY);
+		__m256 w = ease(fracZ);
+		__m256 frontHorz = mix(mix(dots[3], dots[1], v), mix(dots[2], dots[0], v), u);
+		__m256 backHorz = mix(mix(dots[7], dots[5], v), mix(dots[6], dots[4], v), u);
+		__m256 value = mix(backHorz, frontHorz, w);
+
+		__m256 rateX = _mm256_mul_ps(easeDerivative(fracX), mix(
+					mix(_mm256_sub_ps(dots[6], dots[7]), _mm256_sub_ps(dots[4], dots[5]), v),
+					mix(_mm256_sub_ps(dots[2], dots[3]), _mm256_sub_ps(dots[0], dots[1]), v), w));
+		__m256 rateY = _mm256_mul_ps(easeDerivative(fracY), mix(
+					mix(_mm256_sub_ps(dots[5], dots[7]), _mm256_sub_ps(dots[4], dots[6]), u),
+					mix(_mm256_sub_ps(dots[1], dots[3]), _mm256_sub_ps(dots[0], dots[2]), u), w));
+		__m256 rateZ = _mm256_mul_ps(easeDerivative(fracZ), _mm256_sub_ps(frontHorz, backHorz));
+
+		dx = _mm256_mul_ps(_mm256_add_ps(blend(gx, u, v, w), rateX), scale);
+		dy = _mm256_mul_ps(_mm256_add_ps(blend(gy, u, v, w), rateY), scale);
+		dz = _mm256_mul_ps(_mm256_add_ps(blend(gz, u, v, w), rateZ), scale);
+		return _mm256_mul_ps(_mm256_add_ps(value, _mm256_set1_ps(3.0f)), scale);
+	}
+}
+
+void NoiseKernels::noise2Avx2(const int* perm, const float* x, const float* y, float* out, std::size_t count)
+{
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		_mm256_storeu_ps(out + i, noise2x8(perm, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+	}
+	noise2Scalar(perm, x + i, y + i, out + i, count - i);
+}
+
+void NoiseKernels::noise3Avx2(const int* perm, const float* x, const float* y, const float* z,
+		float* out, std::size_t count)
+{
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		_mm256_storeu_ps(out + i, noise3x8(perm, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i),
+					_mm256_loadu_ps(z + i), _mm256_set1_epi32(255)));
+	}
+	noise3Scalar(perm, x + i, y + i, z + i, out + i, count - i);
+}
+
+void NoiseKernels::noise3GradAvx2(const int* perm, const float* x, const float* y, const float* z,
+		float* out, float* dx, float* dy, float* dz, std::size_t count)
+{
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 gx, gy, gz;
+		_mm256_storeu_ps(out + i, noise3Gradx8(perm, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i),
+					_mm256_loadu_ps(z + i), gx, gy, gz));
+		_mm256_storeu_ps(dx + i, gx);
+		_mm256_storeu_ps(dy + i, gy);
+		_mm256_storeu_ps(dz + i, gz);
+	}
+	noise3GradScalar(perm, x + i, y + i, z + i, out + i, dx + i, dy + i, dz + i, count - i);
+}
+
+void NoiseKernels::turbulenceAvx2(const int* perm, const float* x, const float* y, const float* z,
+		float* out, std::size_t count, const Octave* octaves, int octaveCount, float offset)
+{
+	const __m256 offsets = _mm256_set1_ps(offset);
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 px = _mm256_loadu_ps(x + i);
+		__m256 py = _mm256_loadu_ps(y + i);
+		__m256 pz = _mm256_loadu_ps(z + i);
+		__m256 total = _mm256_setzero_ps();
+		for (int o = 0; o < octaveCount; o++)
+		{
+			__m256 freq = _mm256_set1_ps(octaves[o].freq);
+			__m256 n = noise3x8(perm, _mm256_add_ps(_mm256_mul_ps(px, freq), offsets),
+					_mm256_add_ps(_mm256_mul_ps(py, freq), offsets),
+					_mm256_add_ps(_mm256_mul_ps(pz, freq), offsets), _mm256_set1_epi32(octaves[o].mask));
+			total = _mm256_add_ps(total, _mm256_mul_ps(n, _mm256_set1_ps(octaves[o].amp)));
+		}
+		_mm256_storeu_ps(out + i, total);
+	}
+	turbulenceScalar(perm, x + i, y + i, z + i, out + i, count - i, octaves, octaveCount, offset);
+}
+
+#else
+
+// Built without -mavx2, so fall back to the scalar kernels.
+void NoiseKernels::noise2Avx2(const int* perm, const float* x, const float* y, float* out, std::size_t count)
+{
+	noise2Scalar(perm, x, y, out, count);
+}
+
+void NoiseKernels::noise3Avx2(const int* perm, const float* x, const float* y, const float* z,
+		float* out, std::size_t count)
+{
+	noise3Scalar(perm, x, y, z, out, count);
+}
+
+void NoiseKernels::noise3GradAvx2(const int* perm, const float* x, const float* y, const float* z,
+		float* out, float* dx, float* dy, float* dz, std::size_t count)
+{
+	noise3GradScalar(perm, x, y, z, out, dx, dy, dz, count);
+}
+
+void NoiseKernels::turbulenceAvx2(const int* perm, const float* x, const float* y, const float* z,
+		float* out, std::size_t count, const Octave* octaves, int octaveCount, float offset)
+{
+	turbulenceScalar(perm, x, y, z, out, count, octaves, octaveCount, offset);
+}
+
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+ * Internal to the noise library. Every kernel takes the 512 entry
+ * permutation table and processes all count points, including any tail
+ * that does not fill a whole SIMD register.
+ */
+namespace NoiseKernels
+{
+	const float SQRT2 = 1.41421356273f;
+	const float SQRT3 = 1.73205080757f;
+
+	// Gradient tables indexed by (cornerValue & 3) and (cornerValue & 7).
+	// These match getGradient2D() and getGradient3D() in noise.glsl.
+	alignas(32) const float GRAD2_X[8] = { SQRT2, 0, -SQRT2, 0, SQRT2, 0, -SQRT2, 0 };
+	alignas(32) const float GRAD2_Y[8] = { 0, SQRT2, 0, -SQRT2, 0, SQRT2, 0, -SQRT2 };
+	alignas(32) const float GRAD3_X[8] = { SQRT3, 0, -SQRT3, 0, 0, 0, 0, 0 };
+	alignas(32) const float GRAD3_Y[8] = { 0, SQRT3, 0, -SQRT3, 0, 0, -SQRT3 / SQRT2, SQRT3 / SQRT2 };
+	alignas(32) const float GRAD3_Z[8] = { 0, 0, 0, 0, SQRT3, -SQRT3, SQRT3 / SQRT2, -SQRT3 / SQRT2 };
+
+	float noise2(const int* perm, float x, float y);
+	/*
+	 * One octave of turbulence. mask wraps the lattice coordinates so the
+	 * octave repeats every mask + 1 lattice units. With the default of 255
+	 * the doubled permutation table makes the wrap match the shader exactly.
+	 */
+	struct Octave
+	{
+		float freq;
+		float amp;
+		int mask;
+	};
+
+	float noise3(const int* perm, float x, float y, float z, int mask = 255);
+	float noise3Grad(const int* perm, float x, float y, float z, float gradient[3]);
+
+	typedef void (*Noise2Fn)(const int* perm, const float* x, const float* y, float* out, std::size_t count);
+	typedef void (*Noise3Fn)(const int* perm, const float* x, const float* y, const float* z,
+			float* out, std::size_t count);
+	typedef void (*Noise3GradFn)(const int* perm, const float* x, const float* y, const float* z,
+			float* out, float* dx, float* dy, float* dz, std::size_t count);
+	typedef void (*TurbulenceFn)(const int* perm, const float* x, const float* y, const float* z,
+			float* out, std::size_t count, const Octave* octaves, int octaveCount, float offset);
+
+	void noise2Scalar(const int* perm, const float* x, const float* y, float* out, std::size_t count);
+	void noise3Scalar(const int* perm, const float* x, const float* y, const float* z,
+			float* out, std::size_t count);
+	void noise3GradScalar(const int* perm, const float* x, const float* y, const float* z,
+			float* out, float* dx, float* dy, float* dz, std::size_t count);
+	void turbulenceScalar(const int* perm, const float* x, const float* y, const float* z,
+			float* out, std::size_t count, const Octave* octaves, int octaveCount, float offset);
+
+	void noise2Sse41(const int* perm, const float* x, const float* y, float* out, std::size_t count);
+	void noise3Sse41(const int* perm, const float* x, const float* y, const float* z,
+			float* out, std::size_t count);
+	void turbulenceSse41(const int* perm, const float* x, const float* y, const float* z,
+			float* out, std::size_t count, const Octave* octaves, int octaveCount, float offset);
+
+	void noise2Avx2(const int* perm, const float* x, const float* y, float* out, std::size_t count);
+	void noise3Avx2(const int* perm, const float* x, const float* y, const float* z,
+			float* out, std::size_t count);
+	void noise3GradAvx2(const int* perm, const float* x, const float* y, const float* z,
+			float* out, float* dx, float* dy, float* dz, std::size_t count);
+	void turbulenceAvx2(const int* perm, const float* x, const float* y, const float* z,
+			float* out, std::size_t count, const Octave* octaves, int octaveCount, float offset);
+}
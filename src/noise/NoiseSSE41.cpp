@@ -0,0 +1,211 @@
+/*
+ * Four lane batch kernels. This file is compiled with -msse4.1 and is only
+ * called after Noise has checked that the CPU supports SSE4.1. There is no
+ * gather or variable permute, so table lookups are done one lane at a time.
+ */
+
+#include "NoiseKernels.h"
+
+#if defined(__SSE4_1__)
+
+#include <smmintrin.h>
+
+namespace
+{
+	inline __m128 ease(__m128 t)
+	{
+		__m128 r = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(6), t), _mm_set1_ps(15));
+		r = _mm_add_ps(_mm_mul_ps(r, t), _mm_set1_ps(10));
+		return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(r, t), t), t);
+	}
+
+	inline __m128 mix(__m128 x, __m128 y, __m128 a)
+	{
+		return _mm_add_ps(_mm_mul_ps(x, _mm_sub_ps(_mm_set1_ps(1), a)), _mm_mul_ps(y, a));
+	}
+
+	inline __m128i lookup(const int* perm, __m128i index)
+	{
+		return _mm_setr_epi32(perm[_mm_extract_epi32(index, 0)], perm[_mm_extract_epi32(index, 1)],
+				perm[_mm_extract_epi32(index, 2)], perm[_mm_extract_epi32(index, 3)]);
+	}
+
+	inline __m128 lookup(const float* table, __m128i index)
+	{
+		return _mm_setr_ps(table[_mm_extract_epi32(index, 0)], table[_mm_extract_epi32(index, 1)],
+				table[_mm_extract_epi32(index, 2)], table[_mm_extract_epi32(index, 3)]);
+	}
+
+	inline __m128 grad2Dot(__m128i value, __m128 x, __m128 y)
+	{
+		__m128i g = _mm_and_si128(value, _mm_set1_epi32(3));
+		__m128 gx = lookup(NoiseKernels::GRAD2_X, g);
+		__m128 gy = lookup(NoiseKernels::GRAD2_Y, g);
+		return _mm_add_ps(_mm_mul_ps(x, gx), _mm_mul_ps(y, gy));
+	}
+
+	inline __m128 grad3Dot(__m128i value, __m128 x, __m128 y, __m128 z)
+	{
+		__m128i g = _mm_and_si128(value, _mm_set1_epi32(7));
+		__m128 gx = lookup(NoiseKernels::GRAD3_X, g);
+		__m128 gy = lookup(NoiseKernels::GRAD3_Y, g);
+		__m128 gz = lookup(NoiseKernels::GRAD3_Z, g);
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, gx), _mm_mul_ps(y, gy)), _mm_mul_ps(z, gz));
+	}
+
+	__m128 noise2x4(const int* perm, __m128 x, __m128 y)
+	{
+		const __m128 one = _mm_set1_ps(1);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128i mask = _mm_set1_epi32(255);
+		const __m128i onei = _mm_set1_epi32(1);
+
+		__m128i truncX = _mm_cvttps_epi32(x);
+		__m128i truncY = _mm_cvttps_epi32(y);
+		__m128i xi = _mm_and_si128(truncX, mask);
+		__m128i yi = _mm_and_si128(truncY, mask);
+
+		__m128 fracX = _mm_sub_ps(x, _mm_cvtepi32_ps(truncX));
+		__m128 fracY = _mm_sub_ps(y, _mm_cvtepi32_ps(truncY));
+		__m128 signX = _mm_sub_ps(_mm_and_ps(_mm_cmpgt_ps(fracX, zero), one),
+				_mm_and_ps(_mm_cmplt_ps(fracX, zero), one));
+		__m128 signY = _mm_sub_ps(_mm_and_ps(_mm_cmpgt_ps(fracY, zero), one),
+				_mm_and_ps(_mm_cmplt_ps(fracY, zero), one));
+		fracX = _mm_add_ps(fracX, _mm_mul_ps(_mm_add_ps(_mm_sub_ps(zero, signX), one), _mm_set1_ps(0.5f)));
+		fracY = _mm_add_ps(fracY, _mm_mul_ps(_mm_add_ps(_mm_sub_ps(zero, signY), one), _mm_set1_ps(0.5f)));
+
+		__m128i a = _mm_add_epi32(lookup(perm, xi), yi);
+		__m128i b = _mm_add_epi32(lookup(perm, _mm_add_epi32(xi, onei)), yi);
+
+		__m128 fracX1 = _mm_sub_ps(fracX, one);
+		__m128 fracY1 = _mm_sub_ps(fracY, one);
+		__m128 dotTopRight = grad2Dot(lookup(perm, _mm_add_epi32(b, onei)), fracX1, fracY1);
+		__m128 dotTopLeft = grad2Dot(lookup(perm, _mm_add_epi32(a, onei)), _mm_sub_ps(fracX, zero), fracY1);
+		__m128 dotBotRight = grad2Dot(lookup(perm, b), fracX1, _mm_sub_ps(fracY, zero));
+		__m128 dotBotLeft = grad2Dot(lookup(perm, a), fracX, fracY);
+
+		__m128 u = ease(fracX);
+		__m128 v = ease(fracY);
+		__m128 value = mix(mix(dotBotLeft, dotTopLeft, v), mix(dotBotRight, dotTopRight, v), u);
+		return _mm_mul_ps(_mm_add_ps(value, _mm_set1_ps(2.0f)), _mm_set1_ps(0.25f));
+	}
+
+	__m128 noise3x4(const int* perm, __m128 x, __m128 y, __m128 z, __m128i mask)
+	{
+		const __m128 one = _mm_set1_ps(1);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128i onei = _mm_set1_epi32(1);
+
+		__m128 floorX = _mm_floor_ps(x);
+		__m128 floorY = _mm_floor_ps(y);
+		__m128 floorZ = _mm_floor_ps(z);
+		__m128i xi = _mm_and_si128(_mm_cvttps_epi32(floorX), mask);
+		__m128i yi = _mm_and_si128(_mm_cvttps_epi32(floorY), mask);
+		__m128i zi = _mm_and_si128(_mm_cvttps_epi32(floorZ), mask);
+
+		__m128 fracX = _mm_sub_ps(x, floorX);
+		__m128 fracY = _mm_sub_ps(y, floorY);
+		__m128 fracZ = _mm_sub_ps(z, floorZ);
+		__m128 fracX1 = _mm_sub_ps(fracX, one);
+		__m128 fracY1 = _mm_sub_ps(fracY, one);
+		__m128 fracZ1 = _mm_sub_ps(fracZ, one);
+		__m128 fracX0 = _mm_sub_ps(fracX, zero);
+		__m128 fracY0 = _mm_sub_ps(fracY, zero);
+		__m128 fracZ0 = _mm_sub_ps(fracZ, zero);
+
+		__m128i xi1 = _mm_and_si128(_mm_add_epi32(xi, onei), mask);
+		__m128i yi1 = _mm_and_si128(_mm_add_epi32(yi, onei), mask);
+		__m128i zi1 = _mm_and_si128(_mm_add_epi32(zi, onei), mask);
+		__m128i a = lookup(perm, xi);
+		__m128i b = lookup(perm, xi1);
+		__m128i aa = lookup(perm, _mm_add_epi32(a, yi));
+		__m128i ab = lookup(perm, _mm_add_epi32(a, yi1));
+		__m128i ba = lookup(perm, _mm_add_epi32(b, yi));
+		__m128i bb = lookup(perm, _mm_add_epi32(b, yi1));
+
+		__m128 dotFrontTopRight = grad3Dot(lookup(perm, _mm_add_epi32(bb, zi1)), fracX1, fracY1, fracZ1);
+		__m128 dotFrontTopLeft = grad3Dot(lookup(perm, _mm_add_epi32(ab, zi1)), fracX0, fracY1, fracZ1);
+		__m128 dotFrontBotRight = grad3Dot(lookup(perm, _mm_add_epi32(ba, zi1)), fracX1, fracY0, fracZ1);
+		__m128 dotFrontBotLeft = grad3Dot(lookup(perm, _mm_add_epi32(aa, zi1)), fracX0, fracY0, fracZ1);
+		__m128 dotBackTopRight = grad3Dot(lookup(perm, _mm_add_epi32(bb, zi)), fracX1, fracY1, fracZ0);
+		__m128 dotBackTopLeft = grad3Dot(lookup(perm, _mm_add_epi32(ab, zi)), fracX0, fracY1, fracZ0);
+		__m128 dotBackBotRight = grad3Dot(lookup(perm, _mm_add_epi32(ba, zi)), fracX1, fracY0, fracZ0);
+		__m128 dotBackBotLeft = grad3Dot(lookup(perm, _mm_add_epi32(aa, zi)), fracX0, fracY0, fracZ0);
+
+		__m128 u = ease(fracX);
+		__m128 v = ease(fracY);
+		__m128 w = ease(fracZ);
+		__m128 frontHorz = mix(mix(dotFrontBotLeft, dotFrontTopLeft, v), mix(dotFrontBotRight, dotFrontTopRight, v), u);
+		__m128 backHorz = mix(mix(dotBackBotLeft, dotBackTopLeft, v), mix(dotBackBotRight, dotBackTopRight, v), u);
+		__m128 value = mix(backHorz, frontHorz, w);
+		return _mm_mul_ps(_mm_add_ps(value, _mm_set1_ps(3.0f)), _mm_set1_ps(0.16667f));
+	}
+}
+
+void NoiseKernels::noise2Sse41(const int* perm, const float* x, const float* y, float* out, std::size_t count)
+{
+	std::size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_ps(out + i, noise2x4(perm, _mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+	}
+	noise2Scalar(perm, x + i, y + i, out + i, count - i);
+}
+
+void NoiseKernels::noise3Sse41(const int* perm, const float* x, const float* y, const float* z,
+		float* out, std::size_t count)
+{
+	std::size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_ps(out + i, noise3x4(perm, _mm_loadu_ps(x + i), _mm_loadu_ps(y + i), _mm_loadu_ps(z + i),
+					_mm_set1_epi32(255)));
+	}
+	noise3Scalar(perm, x + i, y + i, z + i, out + i, count - i);
+}
+
+void NoiseKernels::turbulenceSse41(const int* perm, const float* x, const float* y, const float* z,
+		float* out, std::size_t count, const Octave* octaves, int octaveCount, float offset)
+{
+	const __m128 offsets = _mm_set1_ps(offset);
+	std::size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		__m128 pz = _mm_loadu_ps(z + i);
+		__m128 total = _mm_setzero_ps();
+		for (int o = 0; o < octaveCount; o++)
+		{
+			__m128 freq = _mm_set1_ps(octaves[o].freq);
+			__m128 n = noise3x4(perm, _mm_add_ps(_mm_mul_ps(px, freq), offsets),
+					_mm_add_ps(_mm_mul_ps(py, freq), offsets),
+					_mm_add_ps(_mm_mul_ps(pz, freq), offsets), _mm_set1_epi32(octaves[o].mask));
+			total = _mm_add_ps(total, _mm_mul_ps(n, _mm_set1_ps(octaves[o].amp)));
+		}
+		_mm_storeu_ps(out + i, total);
+	}
+	turbulenceScalar(perm, x + i, y + i, z + i, out + i, count - i, octaves, octaveCount, offset);
+}
+
+#else
+
+// Built without -msse4.1, so fall back to the scalar kernels.
+void NoiseKernels::noise2Sse41(const int* perm, const float* x, const float* y, float* out, std::size_t count)
+{
+	noise2Scalar(perm, x, y, out, count);
+}
+
+void NoiseKernels::noise3Sse41(const int* perm, const float* x, const float* y, const float* z,
+		float* out, std::size_t count)
+{
+	noise3Scalar(perm, x, y, z, out, count);
+}
+
+void NoiseKernels::turbulenceSse41(const int* perm, const float* x, const float* y, const float* z,
+		float* out, std::size_t count, const Octave* octaves, int octaveCount, float offset)
+{
+	turbulenceScalar(perm, x, y, z, out, count, octaves, octaveCount, offset);
+}
+
+#endif